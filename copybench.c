@@ -0,0 +1,157 @@
+/*
+ * copybench.c - Compares the mm_memcpy() copy loops with libc memcpy
+ *
+ * For every power of two size from 16 bytes to 4 MiB, each copy
+ * loop the CPU supports and libc memcpy are timed copying between
+ * the same two buffers, and the throughput is printed in GB/s. The
+ * sizes from MM_COPY_NT up take the non-temporal stores. Each loop
+ * is first checked against libc on sizes around MM_COPY_NT, to
+ * destinations off every alignment the stores care about.
+ *
+ * usage: copybench [-v]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mmcopy.h"
+#include "fsecs.h"
+
+#define MIN_SIZE	16				/* smallest copy (bytes) */
+#define MAX_SIZE	(4*(1<<20))		/* largest copy (bytes) */
+#define WORK		(8*(1<<20))		/* bytes copied per timed call */
+#define SLACK		64				/* room to misalign the checked copies */
+
+#if MM_COPY_NT + 77 > MAX_SIZE
+#error "MM_COPY_NT is past the sizes copybench checks"
+#endif
+
+int verbose = 0;	/* used by fsecs.c */
+
+/* Holds the params to the timed copy functions */
+typedef struct {
+	char *dest;
+	char *src;
+	size_t size;	/* bytes per copy */
+	int reps;		/* copies per call */
+} copy_t;
+
+/* Copy loops to compare, besides libc */
+static const char *loops[] = { "words", "sse2", "avx2", NULL };
+
+static void bench_mm(void *argp)
+{
+	copy_t *p = argp;
+	for (int i = 0; i < p->reps; i++) {
+		mm_memcpy(p->dest, p->src, p->size);
+	}
+}
+
+static void bench_libc(void *argp)
+{
+	copy_t *p = argp;
+	for (int i = 0; i < p->reps; i++) {
+		memcpy(p->dest, p->src, p->size);
+		__asm__ volatile("" : : "r"(p->dest) : "memory");	/* keep every copy */
+	}
+}
+
+/*
+ * check - Copies sizes around MM_COPY_NT with the loop in use to
+ *     unaligned destinations, exits if any differs from src or
+ *     writes outside its bytes
+ */
+static void check(const char *name, char *dest, const char *src)
+{
+	static const size_t sizes[] = { MM_COPY_NT - 1, MM_COPY_NT, MM_COPY_NT + 77 };
+	static const int offsets[] = { 0, 1, 15, 33, 63 };
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (size_t j = 0; j < sizeof(offsets) / sizeof(offsets[0]); j++) {
+			size_t n = sizes[i];
+			int off = offsets[j];
+
+			memset(dest, 0, MAX_SIZE + SLACK);
+			mm_memcpy(dest + off, src + 3, n);
+			if (memcmp(dest + off, src + 3, n) != 0) {
+				fprintf(stderr, "copybench: %s copy of %zu bytes to offset %d is wrong\n",
+						name, n, off);
+				exit(1);
+			}
+			for (char *p = dest; p < dest + MAX_SIZE + SLACK; p++) {
+				if (*p != 0 && (p < dest + off || p >= dest + off + n)) {
+					fprintf(stderr, "copybench: %s copy of %zu bytes to offset %d "
+							"wrote byte %td\n", name, n, off, p - dest);
+					exit(1);
+				}
+			}
+		}
+	}
+}
+
+/* Returns throughput of one copy function in GB/s */
+static double gbps(void (*f)(void *), copy_t *p)
+{
+	return (double)p->size * p->reps / fsecs(f, p) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	copy_t params;
+	char c;
+	int i;
+
+	while ((c = getopt(argc, argv, "v")) != EOF) {
+		switch (c) {
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: copybench [-v]\n");
+			exit(1);
+		}
+	}
+
+	if (posix_memalign((void **)&params.dest, 64, MAX_SIZE + SLACK) != 0 ||
+		posix_memalign((void **)&params.src, 64, MAX_SIZE + SLACK) != 0) {
+		fprintf(stderr, "copybench: out of memory\n");
+		exit(1);
+	}
+	// no zero bytes, so check() can spot stray writes
+	for (i = 0; i < MAX_SIZE + SLACK; i++) {
+		params.src[i] = (char)(i % 251 + 1);
+	}
+	for (i = 0; loops[i] != NULL; i++) {
+		if (mm_memcpy_use(loops[i]) == 0) {
+			check(loops[i], params.dest, params.src);
+		}
+	}
+	memset(params.dest, 0, MAX_SIZE + SLACK);
+	init_fsecs();
+
+	printf("Throughput in GB/s, non-temporal from %d bytes, default loop %s\n",
+		   MM_COPY_NT, mm_memcpy_name());
+	printf("%8s%8s", "bytes", "libc");
+	for (i = 0; loops[i] != NULL; i++) {
+		if (mm_memcpy_use(loops[i]) == 0) {
+			printf("%8s", loops[i]);
+		}
+	}
+	printf("\n");
+
+	for (params.size = MIN_SIZE; params.size <= MAX_SIZE; params.size *= 2) {
+		params.reps = WORK / params.size;
+		printf("%8zu%8.2f", params.size, gbps(bench_libc, &params));
+		for (i = 0; loops[i] != NULL; i++) {
+			if (mm_memcpy_use(loops[i]) == 0) {
+				printf("%8.2f", gbps(bench_mm, &params));
+			}
+		}
+		printf("\n");
+	}
+
+	free(params.dest);
+	free(params.src);
+	return 0;
+}
@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <stdint.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -31,7 +32,7 @@
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((uintptr_t)(p)) % ALIGNMENT) == 0)
 
 /****************************** 
  * The key compound data types 
@@ -46,9 +47,10 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    enum {ALLOC, FREE, REALLOC, CALLOC, MEMALIGN} type; /* type of request */
     int index;                        /* index for free() to use later */
     int size;                         /* byte size of alloc/realloc request */
+    int align;                        /* alignment of memalign request */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -60,6 +62,7 @@ typedef struct {
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    char **batch;        /* blocks of the batched requests being run (-B) */
 } trace_t;
 
 /* 
@@ -81,6 +84,12 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    mm_counters_t counters; /* mm event counters from the utilization run */
+    size_t heap_peak; /* most heap and mapped bytes held in that run */
+    size_t heap_end;  /* ... and those still held at its end */
+    size_t heap_resident; /* ... of which were in physical memory */
+    double lat_p999; /* 99.9th percentile request time (usecs), with -L */
+    double lat_max;  /* ... and the longest */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -90,6 +99,10 @@ typedef struct {
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int batch = 0;   /* if set, run request runs with the batch calls (-B) */
+static int sized = 0;   /* if set, free with mm_free_sized() (-F) */
+static int latency = 0; /* if set, time each request on its own (-L) */
+static int policies = 0; /* if set, run every trace under every placement policy (-P) */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -124,9 +137,20 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void speed_op(trace_t *trace, int i);
+static void eval_mm_latency(trace_t *trace, stats_t *stats);
+static void eval_mm_policies(int n, char **tracefiles);
+static int eval_mm_batch(trace_t *trace, int i);
+
+/* These functions save and load the results of a run */
+static void write_results(char *filename, int n, char **tracefiles, stats_t *stats);
+static stats_t *read_results(char *filename, int n);
 
 /* Various helper routines */
-static void printresults(int n, stats_t *stats);
+static void printresults(int n, stats_t *stats, stats_t *base);
+static void printcounters(int n, stats_t *stats);
+static void printlatency(int n, stats_t *stats);
+static int double_cmp(const void *a, const void *b);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -145,11 +169,17 @@ int main(int argc, char **argv)
     range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    stats_t *base_stats = NULL;/* baseline mm stats to compare against (-b) */
+    char *base_file = NULL;    /* file to read baseline results from (-b) */
+    char *save_file = NULL;    /* file to save mm results to (-s) */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
 
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    size_t grow_min;     /* heap growth policy (-G) */
+    int grow_shift;
+    unsigned int grow_window;
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,8 +188,36 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:b:s:p:G:hvVgalBFLP")) != EOF) {
         switch (c) {
+	case 'b': /* Compare the mm results with a saved baseline */
+	    base_file = optarg;
+	    break;
+	case 's': /* Save the mm results as a baseline */
+	    save_file = optarg;
+	    break;
+	case 'B': /* Batch runs of same size allocs and of frees */
+	    batch = 1;
+	    break;
+	case 'F': /* Pass the block size to free */
+	    sized = 1;
+	    break;
+	case 'L': /* Report per request latency */
+	    latency = 1;
+	    break;
+	case 'p': /* Limit the free blocks a fit search looks at */
+	    mm_probe_limit(atoi(optarg));
+	    break;
+	case 'G': /* Set the heap growth policy of every arena */
+	    if (sscanf(optarg, "%zu,%d,%u", &grow_min, &grow_shift, &grow_window) != 3 ||
+		mm_grow_policy(-1, grow_min, grow_shift, grow_window) < 0) {
+		fprintf(stderr, "mdriver: bad growth policy %s\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'P': /* Compare the placement policies */
+	    policies = 1;
+	    break;
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
 	    break;
@@ -269,7 +327,7 @@ int main(int argc, char **argv)
 	/* Display the libc results in a compact table */
 	if (verbose) {
 	    printf("\nResults for libc malloc:\n");
-	    printresults(num_tracefiles, libc_stats);
+	    printresults(num_tracefiles, libc_stats, NULL);
 	}
     }
 
@@ -287,6 +345,12 @@ int main(int argc, char **argv)
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
+    /* Optionally compare the placement policies instead */
+    if (policies) {
+	eval_mm_policies(num_tracefiles, tracefiles);
+	exit(0);
+    }
+
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i=0; i < num_tracefiles; i++) {
 	trace = read_trace(tracedir, tracefiles[i]);
@@ -297,21 +361,43 @@ int main(int argc, char **argv)
 	if (mm_stats[i].valid) {
 	    if (verbose > 1)
 		printf("memory efficiency, ");
+	    /* Fresh zero memory, so the counters see a new process heap */
+	    mem_deinit();
+	    mem_init();
 	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_get_counters(&mm_stats[i].counters);
+	    mm_stats[i].heap_peak = mem_peaksize();
+	    mm_stats[i].heap_end = mem_heapsize() + mem_mapsize();
+	    mm_stats[i].heap_resident = mem_resident();
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
 		printf("and performance.\n");
 	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (latency)
+		eval_mm_latency(trace, &mm_stats[i]);
 	}
 	//mm_checkheap(1);
 	free_trace(trace);
     }
 
+    /* Optionally save the results and compare them with a baseline */
+    if (save_file)
+	write_results(save_file, num_tracefiles, tracefiles, mm_stats);
+    if (base_file)
+	base_stats = read_results(base_file, num_tracefiles);
+
     /* Display the mm results in a compact table */
     if (verbose) {
 	printf("\nResults for mm malloc:\n");
-	printresults(num_tracefiles, mm_stats);
+	printresults(num_tracefiles, mm_stats, base_stats);
+	printf("\nCounters for mm malloc:\n");
+	printcounters(num_tracefiles, mm_stats);
+	printf("\n");
+    }
+    if (latency) {
+	printf("Latency for mm malloc (probe limit %d):\n", mm_probe_limit(-1));
+	printlatency(num_tracefiles, mm_stats);
 	printf("\n");
     }
 
@@ -396,9 +482,10 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap, or a mapping */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+	!mem_mapped_range(lo, size)) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -478,7 +565,7 @@ static trace_t *read_trace(char *tracedir, char *filename)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, align;
     unsigned max_index = 0;
     unsigned op_index;
 
@@ -516,6 +603,11 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
     
+    /* ... and room for the blocks of one batched run of requests */
+    if ((trace->batch = 
+	 (char **)malloc(trace->num_ops * sizeof(char *))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
+    
     /* read every request line in the trace file */
     index = 0;
     op_index = 0;
@@ -528,6 +620,21 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
+	case 'c':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = CALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    fscanf(tracefile, "%u %u %u", &index, &align, &size);
+	    trace->ops[op_index].type = MEMALIGN;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].align = align;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
 	case 'r':
 	    fscanf(tracefile, "%u %u", &index, &size);
 	    trace->ops[op_index].type = REALLOC;
@@ -556,17 +663,66 @@ static trace_t *read_trace(char *tracedir, char *filename)
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
+ * free_trace - Free the trace record and the four arrays it points
  *              to, all of which were allocated in read_trace().
  */
 void free_trace(trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
+    free(trace->ops);         /* free the four arrays... */
     free(trace->blocks);      
     free(trace->block_sizes);
+    free(trace->batch);
     free(trace);              /* and the trace record itself... */
 }
 
+/*
+ * write_results - save the util and throughput of each trace so that
+ *     a later run can be compared against it with -b
+ */
+static void write_results(char *filename, int n, char **tracefiles, stats_t *stats)
+{
+    FILE *fp;
+    int i;
+
+    if ((fp = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in write_results", filename);
+	unix_error(msg);
+    }
+    for (i = 0; i < n; i++) {
+	fprintf(fp, "%s %d %f %f %f\n", tracefiles[i], stats[i].valid,
+		stats[i].util, stats[i].ops, stats[i].secs);
+    }
+    fclose(fp);
+}
+
+/*
+ * read_results - load results saved by write_results, which must
+ *     have been produced from the same n tracefiles
+ */
+static stats_t *read_results(char *filename, int n)
+{
+    FILE *fp;
+    stats_t *stats;
+    char name[MAXLINE];
+    int i;
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	sprintf(msg, "Could not open %s in read_results", filename);
+	unix_error(msg);
+    }
+    if ((stats = (stats_t *)calloc(n, sizeof(stats_t))) == NULL)
+	unix_error("calloc failed in read_results");
+    for (i = 0; i < n; i++) {
+	if (fscanf(fp, "%s %d %lf %lf %lf", name, &stats[i].valid,
+		   &stats[i].util, &stats[i].ops, &stats[i].secs) != 5) {
+	    sprintf(msg, "%s does not hold results for %d traces", filename, n);
+	    app_error(msg);
+	}
+    }
+    fclose(fp);
+    return stats;
+}
+
 /**********************************************************************
  * The following functions evaluate the correctness, space utilization,
  * and throughput of the libc and mm malloc packages.
@@ -577,14 +733,13 @@ void free_trace(trace_t *trace)
  */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
 {
-    int i, j;
+    int i, j, n;
     int index;
     int size;
     int oldsize;
     char *newp;
     char *oldp;
     char *p;
-	 int *check;
 	 int init_status;
     
     /* Reset the heap and free any records in the range list */
@@ -593,12 +748,12 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 
     /* Call the mm package's init function */
 	 init_status = mm_init();
-	 check = (int *) (init_status - 8);
     if (init_status == -1) {
 		malloc_error(tracenum, 0, "mm_init failed.");
 		return 0;
     }
-	 else if (*check != ~KEY2)
+	 /* The key is the first word of the heap, read back as 32 bits */
+	 else if (*(unsigned int *)mem_heap_lo() != ~KEY2)
 	 {
 		 return 0;
 	 }
@@ -608,12 +763,41 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	index = trace->ops[i].index;
 	size = trace->ops[i].size;
 
+	/* With -B, check the blocks of a batched run one by one */
+	if ((n = eval_mm_batch(trace, i)) < 0) {
+	    malloc_error(tracenum, i, "mm_malloc_batch failed.");
+	    return 0;
+	}
+	for (j = i; j < i + n; j++) {
+	    p = trace->blocks[trace->ops[j].index];
+	    if (trace->ops[j].type == FREE) {
+		remove_range(ranges, p);
+		continue;
+	    }
+	    if (add_range(ranges, p, size, tracenum, j) == 0)
+		return 0;
+	    memset(p, trace->ops[j].index & 0xFF, size);
+	    trace->block_sizes[trace->ops[j].index] = size;
+	}
+	if (n > 0) {
+	    i += n - 1;
+	    continue;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
-
-	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
+
+	    /* Call the student's malloc, calloc or memalign */
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_malloc(size);
+	    if (p == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -625,6 +809,25 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     */ 
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
 		return 0;
+
+	    /* A memalign'd block must have the alignment asked for */
+	    if (trace->ops[i].type == MEMALIGN &&
+		((uintptr_t)p % trace->ops[i].align) != 0) {
+		sprintf(msg, "mm_memalign returned %p, not %d-byte aligned",
+			p, trace->ops[i].align);
+		malloc_error(tracenum, i, msg);
+		return 0;
+	    }
+
+	    /* A calloc'd block must read as all zeros */
+	    if (trace->ops[i].type == CALLOC) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc did not zero the block");
+			return 0;
+		    }
+		}
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -662,7 +865,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -680,7 +883,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    if (sized)
+		mm_free_sized(p, trace->block_sizes[index]);
+	    else
+		mm_free(p);
 	    break;
 
 	default:
@@ -698,15 +904,14 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   The idea is to remember the high water mark "hwm" of the heap for 
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the 
- *   size of the heap in bytes after running the student's malloc 
- *   package on the trace. Note that our implementation of mem_sbrk() 
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap. 
+ *   most memory the student's malloc package held at once while
+ *   running the trace: the heap plus any blocks it gave mappings of
+ *   their own with mem_map(), as tracked by mem_peaksize(). 
  *   
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 {   
-    int i;
+    int i, j, n;
     int index;
     int size, newsize, oldsize;
     int max_total_size = 0;
@@ -720,13 +925,40 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	app_error("mm_init failed in eval_mm_util");
 
     for (i = 0;  i < trace->num_ops;  i++) {
+	/* With -B, account for a batched run in one go */
+	if ((n = eval_mm_batch(trace, i)) < 0)
+	    app_error("mm_malloc_batch failed in eval_mm_util");
+	for (j = i; j < i + n; j++) {
+	    index = trace->ops[j].index;
+	    if (trace->ops[j].type == FREE) {
+		total_size -= trace->block_sizes[index];
+		continue;
+	    }
+	    trace->block_sizes[index] = trace->ops[j].size;
+	    total_size += trace->ops[j].size;
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	}
+	if (n > 0) {
+	    i += n - 1;
+	    continue;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if (trace->ops[i].type == CALLOC)
+		p = mm_calloc(1, size);
+	    else if (trace->ops[i].type == MEMALIGN)
+		p = mm_memalign(trace->ops[i].align, size);
+	    else
+		p = mm_malloc(size);
+	    if (p == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -769,7 +1001,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    if (sized)
+		mm_free_sized(p, size);
+	    else
+		mm_free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -783,7 +1018,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    return ((double)max_total_size / (double)mem_peaksize());
 }
 
 
@@ -793,8 +1028,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
-    char *p, *newp, *oldp, *block;
+    int i, n;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
     /* Reset the heap and initialize the mm package */
@@ -803,7 +1037,26 @@ static void eval_mm_speed(void *ptr)
 	app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if ((n = eval_mm_batch(trace, i)) < 0)
+	    app_error("mm_malloc_batch error in eval_mm_speed");
+	if (n > 0) {
+	    i += n - 1;
+	    continue;
+	}
+	speed_op(trace, i);
+    }
+}
+
+/*
+ * speed_op - Runs request i of the trace, for eval_mm_speed and
+ *    eval_mm_latency
+ */
+static void speed_op(trace_t *trace, int i)
+{
+    int index, size, newsize;
+    char *p, *newp, *oldp, *block;
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
@@ -814,6 +1067,22 @@ static void eval_mm_speed(void *ptr)
             trace->blocks[index] = p;
             break;
 
+        case CALLOC: /* mm_calloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_calloc(1, size)) == NULL)
+		app_error("mm_calloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
+        case MEMALIGN: /* mm_memalign */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+		app_error("mm_memalign error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
 	case REALLOC: /* mm_realloc */
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
@@ -826,7 +1095,11 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+	    /* block_sizes holds each block's last size from eval_mm_util */
+	    if (sized)
+		mm_free_sized(block, trace->block_sizes[index]);
+	    else
+		mm_free(block);
             break;
 
 	default:
@@ -834,6 +1107,169 @@ static void eval_mm_speed(void *ptr)
         }
 }
 
+/*
+ * eval_mm_latency - Runs the trace once timing every request on its
+ *    own, and sets the 99.9th percentile and the largest of those
+ *    times in stats. Requests are never batched here.
+ */
+static void eval_mm_latency(trace_t *trace, stats_t *stats)
+{
+    struct timespec t0, t1;
+    double *usecs;
+    int i;
+
+    if ((usecs = malloc(trace->num_ops * sizeof(double))) == NULL)
+	unix_error("malloc in eval_mm_latency failed");
+
+    mem_reset_brk();
+    if (mm_init() == -1) 
+	app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	speed_op(trace, i);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	usecs[i] = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+    }
+
+    qsort(usecs, trace->num_ops, sizeof(double), double_cmp);
+    stats->lat_p999 = usecs[(int)(0.999 * (trace->num_ops - 1))];
+    stats->lat_max = usecs[trace->num_ops - 1];
+    free(usecs);
+}
+
+/*
+ * eval_mm_policies - Runs every trace under every placement policy
+ *    and split the mm package accepts, and prints a table of the
+ *    utilization and one of the Kops of each
+ */
+static void eval_mm_policies(int n, char **tracefiles)
+{
+    static const char *fits[] = { "first", "next", "best", "good", "address" };
+    static const char *splits[] = { "front", "back" };
+    const char *names[2 * sizeof(fits) / sizeof(fits[0])];  /* fit of each column */
+    int backs[2 * sizeof(fits) / sizeof(fits[0])];          /* ... and its split */
+    int ncols = 0, i, j, k, nfits = 0;
+    double *util, *kops, sum;
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    char label[MAXLINE];
+
+    /* A free block index with a placement of its own takes no fit */
+    for (i = 0; i < (int)(sizeof(fits) / sizeof(fits[0])); i++) {
+	if (mm_fit_use(fits[i]) == 0)
+	    names[nfits++] = fits[i];
+    }
+    if (nfits == 0)
+	names[nfits++] = mm_fit_name();
+    for (k = 0; k < 2; k++) {
+	for (i = 0; i < nfits; i++) {
+	    names[ncols] = names[i];
+	    backs[ncols++] = k;
+	}
+    }
+
+    util = calloc(n * ncols, sizeof(double));
+    kops = calloc(n * ncols, sizeof(double));
+    if (util == NULL || kops == NULL)
+	unix_error("calloc in eval_mm_policies failed");
+
+    for (j = 0; j < ncols; j++) {
+	mm_fit_use(names[j]);
+	mm_split_use(splits[backs[j]]);
+	for (i = 0; i < n; i++) {
+	    trace = read_trace(tracedir, tracefiles[i]);
+	    if (eval_mm_valid(trace, i, &ranges)) {
+		mem_deinit();
+		mem_init();
+		util[i*ncols + j] = eval_mm_util(trace, i, &ranges);
+		speed_params.trace = trace;
+		speed_params.ranges = ranges;
+		kops[i*ncols + j] = trace->num_ops / fsecs(eval_mm_speed, &speed_params) / 1e3;
+	    }
+	    free_trace(trace);
+	}
+    }
+
+    for (k = 0; k < 2; k++) {
+	printf("\n%s by placement policy:\n%5s", k ? "Kops" : "Utilization", "trace");
+	for (j = 0; j < ncols; j++) {
+	    sprintf(label, "%s%s", names[j], backs[j] ? "/back" : "");
+	    printf("%13s", label);
+	}
+	printf("\n");
+	for (i = 0; i <= n; i++) {
+	    if (i < n)
+		printf("%2d   ", i);
+	    else
+		printf("%-5s", "avg");
+	    for (j = 0; j < ncols; j++) {
+		double *v = k ? kops : util;
+		if (i < n) {
+		    sum = v[i*ncols + j];
+		} else {
+		    sum = 0;
+		    for (int t = 0; t < n; t++)
+			sum += v[t*ncols + j];
+		    sum /= n;
+		}
+		if (k)
+		    printf("%13.0f", sum);
+		else
+		    printf("%12.1f%%", sum * 100.0);
+	    }
+	    printf("\n");
+	}
+    }
+    free(util);
+    free(kops);
+}
+
+/*
+ * double_cmp - qsort comparison of two doubles
+ */
+static int double_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * eval_mm_batch - With -B, runs the requests from i on with one
+ *    mm_malloc_batch() call if they are allocs of the same size, or
+ *    one mm_free_batch() call if they are frees. Returns how many
+ *    requests were run, 0 if request i is left to the caller, or
+ *    -1 if mm_malloc_batch() failed.
+ */
+static int eval_mm_batch(trace_t *trace, int i)
+{
+    traceop_t *ops = trace->ops;
+    int n, k;
+
+    if (!batch || (ops[i].type != ALLOC && ops[i].type != FREE))
+	return 0;
+    for (n = 1; i + n < trace->num_ops && ops[i+n].type == ops[i].type; n++)
+	if (ops[i].type == ALLOC && ops[i+n].size != ops[i].size)
+	    break;
+    if (n == 1)
+	return 0;
+
+    if (ops[i].type == ALLOC) {
+	if (mm_malloc_batch(ops[i].size, n, (void **)trace->batch) != n)
+	    return -1;
+	for (k = 0; k < n; k++)
+	    trace->blocks[ops[i+k].index] = trace->batch[k];
+    }
+    else {
+	for (k = 0; k < n; k++)
+	    trace->batch[k] = trace->blocks[ops[i+k].index];
+	mm_free_batch((void **)trace->batch, n);
+    }
+    return n;
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -856,6 +1292,23 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 	    trace->blocks[trace->ops[i].index] = p;
 	    break;
 
+        case CALLOC: /* calloc */
+	    if ((p = calloc(1, trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc calloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+        case MEMALIGN: /* posix_memalign */
+	    if (posix_memalign((void **)&p, trace->ops[i].align,
+			       trace->ops[i].size) != 0) {
+		malloc_error(tracenum, i, "libc posix_memalign failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
 	case REALLOC: /* realloc */
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[trace->ops[i].index];
@@ -900,6 +1353,22 @@ static void eval_libc_speed(void *ptr)
 	    trace->blocks[index] = p;
 	    break;
 
+        case CALLOC: /* calloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = calloc(1, size)) == NULL)
+		unix_error("calloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
+        case MEMALIGN: /* posix_memalign */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if (posix_memalign((void **)&p, trace->ops[i].align, size) != 0)
+		unix_error("posix_memalign failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
 	case REALLOC: /* realloc */
 	    index = trace->ops[i].index;
 	    newsize = trace->ops[i].size;
@@ -925,9 +1394,10 @@ static void eval_libc_speed(void *ptr)
 
 
 /*
- * printresults - prints a performance summary for some malloc package
+ * printresults - prints a performance summary for some malloc package,
+ *     and the change in util and Kops from base if it isn't NULL
  */
-static void printresults(int n, stats_t *stats) 
+static void printresults(int n, stats_t *stats, stats_t *base) 
 {
     int i;
     double secs = 0;
@@ -935,17 +1405,26 @@ static void printresults(int n, stats_t *stats)
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
+    printf("%5s%7s %5s%8s%10s%6s", 
 	   "trace", " valid", "util", "ops", "secs", "Kops");
+    if (base)
+	printf("%7s%7s", "dutil", "dKops");
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (base && base[i].valid)
+		printf("%+6.0f%%%+7.0f",
+		       (stats[i].util - base[i].util)*100.0,
+		       (stats[i].ops/1e3)/stats[i].secs -
+		       (base[i].ops/1e3)/base[i].secs);
+	    printf("\n");
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
@@ -981,6 +1460,79 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/* 
+ * printcounters - Print the mm package's event counters for each trace
+ */
+static void printcounters(int n, stats_t *stats)
+{
+    int i;
+    mm_counters_t *c;
+
+    printf("%5s%9s%8s%6s%6s%6s%7s%7s%7s%9s%7s%7s%7s%7s%6s%6s%8s%7s%7s%7s%6s%7s%6s%7s\n",
+	   "trace", "reallocs", "inplace", "fwd", "back", "ext",
+	   "grants", "hits", "room", "callocKB", "zeroed",
+	   "batch", "merged", "mapped", "moved", "trims", "peakKB", "endKB",
+	   "purges", "rssKB", "sbrks", "avgext", "fast", "consol");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	c = &stats[i].counters;
+	printf("%2d%12d%7.0f%%%6d%6d%6d%7d%7d%6.1f%%%9ld%6.0f%%%7d%7ld%7d%6d%6d%8zu%7zu%7d%7zu%6d%7ld%5.0f%%%7d\n",
+	       i,
+	       c->reallocs,
+	       c->reallocs ? 100.0 * c->realloc_inplace / c->reallocs : 0.0,
+	       c->realloc_forward,
+	       c->realloc_backward,
+	       c->realloc_extend,
+	       c->headroom_grants,
+	       c->headroom_hits,
+	       c->headroom_shift ? 100.0 / (1 << c->headroom_shift) : 0.0,
+	       c->calloc_bytes / 1024,
+	       c->calloc_bytes ? 100.0 * c->calloc_zeroed / c->calloc_bytes : 0.0,
+	       c->batch_runs,
+	       c->batch_merged,
+	       c->mapped_blocks,
+	       c->map_moves,
+	       c->trims,
+	       stats[i].heap_peak / 1024,
+	       stats[i].heap_end / 1024,
+	       c->purges,
+	       stats[i].heap_resident / 1024,
+	       c->sbrks,
+	       c->sbrks ? c->sbrk_bytes / c->sbrks : 0,
+	       c->fast_mallocs ? 100.0 * c->fast_hits / c->fast_mallocs : 0.0,
+	       c->fast_consolidations);
+    }
+}
+
+/*
+ * printlatency - Print the request latency and the fit search effort
+ *     for each trace
+ */
+static void printlatency(int n, stats_t *stats)
+{
+    int i;
+    mm_counters_t *c;
+
+    printf("%5s%6s%8s%10s%10s%10s%8s\n",
+	   "trace", "valid", "util", "p99.9 us", "max us", "probes", "cutoffs");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid) {
+	    printf("%2d%8s\n", i, "no");
+	    continue;
+	}
+	c = &stats[i].counters;
+	printf("%2d%8s%7.0f%%%10.2f%10.2f%10ld%8d\n",
+	       i,
+	       "yes",
+	       stats[i].util*100.0,
+	       stats[i].lat_p999,
+	       stats[i].lat_max,
+	       c->fit_probes,
+	       c->fit_cutoffs);
+    }
+}
+
 /* 
  * app_error - Report an arbitrary application error
  */
@@ -1013,13 +1565,22 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValBFLP] [-f <file>] [-t <dir>] [-s <file>] [-b <file>] [-p <n>] [-G <min,shift,window>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-b <file>  Compare util and Kops with results saved by -s.\n");
+    fprintf(stderr, "\t-B         Batch runs of same size allocs and of frees.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-F         Free blocks with mm_free_sized().\n");
+    fprintf(stderr, "\t-G <m,s,w> Grow the heap from m bytes, up to 1/2^s of it, doubling\n");
+    fprintf(stderr, "\t           while extensions come within w ops.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L         Report per request latency.\n");
+    fprintf(stderr, "\t-p <n>     Look at no more than n free blocks per fit search.\n");
+    fprintf(stderr, "\t-P         Compare util and Kops under every placement policy.\n");
+    fprintf(stderr, "\t-s <file>  Save the results to <file>.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
@@ -2,7 +2,13 @@
  * memlib.c - a module that simulates the memory system.  Needed because it 
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
+ *
+ * The heap is MAX_REGIONS regions of MAX_HEAP bytes back to back, each
+ * with a break of its own, so an allocator can give every arena a heap
+ * and find the arena of an address by division. mem_sbrk() and the
+ * mem_heap_* functions work on region 0. All calls are thread safe.
  */
+#define _GNU_SOURCE  /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,28 +16,58 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "memlib.h"
 #include "config.h"
 
 /* private variables */
 static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
-static char *mem_max_addr;   /* largest legal heap address */ 
+static char *mem_brk[MAX_REGIONS];    /* points to last byte of each region */
+static char *mem_fresh[MAX_REGIONS];  /* first byte never handed out, zero from here on */
+static size_t mem_heap_total;  /* bytes below the breaks of all regions */
+static size_t mem_mapped;    /* bytes in mappings from mem_map */
+static size_t mem_peak;      /* most heap plus mapped bytes at any one time */
+
+/* Mappings handed out by mem_map, so mem_reset_brk can take them back */
+#define MAX_MAPS 1024
+static struct {
+    char *addr;
+    size_t size;
+} mem_maps[MAX_MAPS];
+static int mem_nmaps;
+
+/* Held by every call that reads or changes the state above */
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* First byte of region r */
+#define REGION_LO(r)	(mem_start_brk + (size_t)(r) * MAX_HEAP)
+
+static void mem_unmap_all(void);
+static size_t mem_resident_range(char *addr, size_t size);
+static void mem_update_peak(void);
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
+    int r;
+
+    /* map the storage we will use to model the available VM, zero filled */
+    if ((mem_start_brk = (char *)mmap(NULL, (size_t)MAX_REGIONS * MAX_HEAP,
+				      PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+				      -1, 0)) == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
 	exit(1);
     }
 
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    for (r = 0; r < MAX_REGIONS; r++) {
+	mem_brk[r] = REGION_LO(r);    /* heap is empty initially */
+	mem_fresh[r] = REGION_LO(r);  /* and all of it is zero */
+    }
+    mem_heap_total = 0;
 }
 
 /* 
@@ -39,41 +75,230 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    mem_unmap_all();
+    munmap(mem_start_brk, (size_t)MAX_REGIONS * MAX_HEAP);
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap,
+ *    and drop any mappings still held
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    int r;
+
+    pthread_mutex_lock(&mem_lock);
+    for (r = 0; r < MAX_REGIONS; r++)
+	mem_brk[r] = REGION_LO(r);
+    mem_heap_total = 0;
+    mem_unmap_all();
+    mem_peak = 0;
+    pthread_mutex_unlock(&mem_lock);
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap, the old break is returned then.
  */
 void *mem_sbrk(int incr) 
 {
-    char *old_brk = mem_brk;
+    return mem_sbrk_region(0, incr);
+}
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+/*
+ * mem_sbrk_region - mem_sbrk for the heap in region r
+ */
+void *mem_sbrk_region(int r, int incr)
+{
+    char *old_brk;
+
+    assert(r >= 0 && r < MAX_REGIONS);
+    pthread_mutex_lock(&mem_lock);
+    old_brk = mem_brk[r];
+    if (old_brk + incr < REGION_LO(r)) {
+	pthread_mutex_unlock(&mem_lock);
+	errno = EINVAL;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Shrunk below the heap start...\n");
+	return (void *)-1;
+    }
+    if (old_brk + incr > REGION_LO(r + 1)) {
+	pthread_mutex_unlock(&mem_lock);
 	errno = ENOMEM;
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
-    mem_brk += incr;
+    mem_brk[r] += incr;
+    mem_heap_total += incr;
+    if (mem_brk[r] > mem_fresh[r])
+	mem_fresh[r] = mem_brk[r];
+    mem_update_peak();
+    pthread_mutex_unlock(&mem_lock);
     return (void *)old_brk;
 }
 
+/*
+ * mem_map - model of an anonymous mmap outside the heap. Returns size
+ *    bytes of zeroed memory, size a multiple of the page size, or NULL.
+ */
+void *mem_map(size_t size)
+{
+    char *addr;
+
+    pthread_mutex_lock(&mem_lock);
+    if (mem_nmaps == MAX_MAPS) {
+	pthread_mutex_unlock(&mem_lock);
+	fprintf(stderr, "ERROR: mem_map failed. Too many mappings...\n");
+	return NULL;
+    }
+    if ((addr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+	pthread_mutex_unlock(&mem_lock);
+	fprintf(stderr, "ERROR: mem_map failed. Ran out of memory...\n");
+	return NULL;
+    }
+    mem_maps[mem_nmaps].addr = addr;
+    mem_maps[mem_nmaps].size = size;
+    mem_nmaps++;
+    mem_mapped += size;
+    mem_update_peak();
+    pthread_mutex_unlock(&mem_lock);
+    return addr;
+}
+
+/*
+ * mem_unmap - give back a mapping of size bytes from mem_map
+ */
+void mem_unmap(void *addr, size_t size)
+{
+    int i;
+
+    pthread_mutex_lock(&mem_lock);
+    for (i = 0; i < mem_nmaps && mem_maps[i].addr != addr; i++)
+	;
+    assert(i < mem_nmaps && mem_maps[i].size == size);
+    munmap(addr, size);
+    mem_mapped -= size;
+    mem_maps[i] = mem_maps[--mem_nmaps];
+    pthread_mutex_unlock(&mem_lock);
+}
+
+/*
+ * mem_remap - resize a mapping from mem_map to newsize bytes, moving it
+ *    if it can't grow where it is. Returns its address, or NULL.
+ */
+void *mem_remap(void *addr, size_t oldsize, size_t newsize)
+{
+    char *newaddr;
+    int i;
+
+    pthread_mutex_lock(&mem_lock);
+    for (i = 0; i < mem_nmaps && mem_maps[i].addr != addr; i++)
+	;
+    assert(i < mem_nmaps && mem_maps[i].size == oldsize);
+    if ((newaddr = mremap(addr, oldsize, newsize, MREMAP_MAYMOVE)) == MAP_FAILED) {
+	pthread_mutex_unlock(&mem_lock);
+	fprintf(stderr, "ERROR: mem_remap failed. Ran out of memory...\n");
+	return NULL;
+    }
+    mem_maps[i].addr = newaddr;
+    mem_maps[i].size = newsize;
+    mem_mapped += newsize - oldsize;
+    mem_update_peak();
+    pthread_mutex_unlock(&mem_lock);
+    return newaddr;
+}
+
+/*
+ * mem_purge - give the heap pages in the size bytes at addr back to
+ *    the system, keeping them in the heap. They read as zero after.
+ */
+void mem_purge(void *addr, size_t size)
+{
+    size_t page = mem_pagesize();
+    char *lo = (char *)(((size_t)addr + page - 1) / page * page);
+    char *hi = (char *)(((size_t)addr + size) / page * page);
+
+    if (lo < hi)
+	madvise(lo, hi - lo, MADV_DONTNEED);
+}
+
+/*
+ * mem_resident_range - return how many of the size bytes at addr, a
+ *    page aligned address, are in physical memory
+ */
+static size_t mem_resident_range(char *addr, size_t size)
+{
+    unsigned char vec[1024];
+    size_t page = mem_pagesize();
+    size_t npages = (size + page - 1) / page;
+    size_t resident = 0;
+    size_t i, n;
+
+    while (npages > 0) {
+	n = npages < sizeof(vec) ? npages : sizeof(vec);
+	if (mincore(addr, n * page, vec) == 0)
+	    for (i = 0; i < n; i++)
+		resident += (vec[i] & 1) * page;
+	addr += n * page;
+	npages -= n;
+    }
+    return resident;
+}
+
+/*
+ * mem_mapped_range - return true if the size bytes at lo lie within
+ *    one mapping from mem_map
+ */
+int mem_mapped_range(void *lo, size_t size)
+{
+    int i, found = 0;
+
+    pthread_mutex_lock(&mem_lock);
+    for (i = 0; i < mem_nmaps && !found; i++)
+	if ((char *)lo >= mem_maps[i].addr &&
+	    (char *)lo + size <= mem_maps[i].addr + mem_maps[i].size)
+	    found = 1;
+    pthread_mutex_unlock(&mem_lock);
+    return found;
+}
+
+/*
+ * mem_unmap_all - give back every mapping still held
+ */
+static void mem_unmap_all(void)
+{
+    while (mem_nmaps > 0) {
+	mem_nmaps--;
+	munmap(mem_maps[mem_nmaps].addr, mem_maps[mem_nmaps].size);
+    }
+    mem_mapped = 0;
+}
+
+/*
+ * mem_update_peak - note the heap and mapped bytes if they are a new high
+ */
+static void mem_update_peak(void)
+{
+    if (mem_heap_total + mem_mapped > mem_peak)
+	mem_peak = mem_heap_total + mem_mapped;
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
 void *mem_heap_lo()
 {
-    return (void *)mem_start_brk;
+    return mem_region_lo(0);
+}
+
+/*
+ * mem_heap_fresh - return address of the first heap byte mem_sbrk has
+ *    not handed out since mem_init, every byte from there on is zero
+ */
+void *mem_heap_fresh()
+{
+    return mem_region_fresh(0);
 }
 
 /* 
@@ -81,15 +306,107 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
-    return (void *)(mem_brk - 1);
+    return mem_region_hi(0);
 }
 
 /*
- * mem_heapsize() - returns the heap size in bytes
+ * mem_region_lo - return address of the first byte of region r
+ */
+void *mem_region_lo(int r)
+{
+    return (void *)REGION_LO(r);
+}
+
+/*
+ * mem_region_fresh - mem_heap_fresh for region r
+ */
+void *mem_region_fresh(int r)
+{
+    char *fresh;
+
+    pthread_mutex_lock(&mem_lock);
+    fresh = mem_fresh[r];
+    pthread_mutex_unlock(&mem_lock);
+    return (void *)fresh;
+}
+
+/*
+ * mem_region_hi - return address of the last heap byte of region r
+ */
+void *mem_region_hi(int r)
+{
+    char *brk;
+
+    pthread_mutex_lock(&mem_lock);
+    brk = mem_brk[r];
+    pthread_mutex_unlock(&mem_lock);
+    return (void *)(brk - 1);
+}
+
+/*
+ * mem_region_size() - returns the heap size of region r in bytes
+ */
+size_t mem_region_size(int r)
+{
+    return (size_t)((char *)mem_region_hi(r) + 1 - REGION_LO(r));
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes, of all regions
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    size_t size;
+
+    pthread_mutex_lock(&mem_lock);
+    size = mem_heap_total;
+    pthread_mutex_unlock(&mem_lock);
+    return size;
+}
+
+/*
+ * mem_mapsize() - returns the bytes in mappings from mem_map
+ */
+size_t mem_mapsize()
+{
+    size_t size;
+
+    pthread_mutex_lock(&mem_lock);
+    size = mem_mapped;
+    pthread_mutex_unlock(&mem_lock);
+    return size;
+}
+
+/*
+ * mem_peaksize() - returns the most heap plus mapped bytes held at
+ *    any one time since mem_reset_brk
+ */
+size_t mem_peaksize()
+{
+    size_t size;
+
+    pthread_mutex_lock(&mem_lock);
+    size = mem_peak;
+    pthread_mutex_unlock(&mem_lock);
+    return size;
+}
+
+/*
+ * mem_resident() - returns the bytes of the heap and of the mappings
+ *    from mem_map that are in physical memory, like a process's RSS
+ */
+size_t mem_resident()
+{
+    size_t resident = 0;
+    int i;
+
+    pthread_mutex_lock(&mem_lock);
+    for (i = 0; i < MAX_REGIONS; i++)
+	resident += mem_resident_range(REGION_LO(i), mem_brk[i] - REGION_LO(i));
+    for (i = 0; i < mem_nmaps; i++)
+	resident += mem_resident_range(mem_maps[i].addr, mem_maps[i].size);
+    pthread_mutex_unlock(&mem_lock);
+    return resident;
 }
 
 /*
@@ -5,9 +5,23 @@
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(int incr);
+void *mem_sbrk_region(int r, int incr);
+void *mem_map(size_t size);
+void mem_unmap(void *addr, size_t size);
+void *mem_remap(void *addr, size_t oldsize, size_t newsize);
+int mem_mapped_range(void *lo, size_t size);
+void mem_purge(void *addr, size_t size);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
+void *mem_heap_fresh(void);
 void *mem_heap_hi(void);
+void *mem_region_lo(int r);
+void *mem_region_fresh(int r);
+void *mem_region_hi(int r);
+size_t mem_region_size(int r);
 size_t mem_heapsize(void);
+size_t mem_mapsize(void);
+size_t mem_peaksize(void);
+size_t mem_resident(void);
 size_t mem_pagesize(void);
 
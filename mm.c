@@ -1,43 +1,148 @@
 /* 
- * mm.c  -  Simple allocator based on explicit free lists and 
- *         	first fit placement. It uses boundary tags and
- * 			a circular doubly linked list to keep track of
- * 			free blocks.
+ * mm.c  -  Simple allocator based on segregated explicit free lists
+ *         	and first fit placement. It uses boundary tags for
+ * 			constant time coalescing and an array of doubly linked
+ * 			lists, one per size class, to keep track of free blocks.
  *
- * Each block has a header and footer of the form:
+ * Each block has a header of the form:
  * 
  *      31                     3  2  1  0 
  *      -----------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  a/f
+ *     | s  s  s  s  ... s  s  s  g pf  f
  *      ----------------------------------- 
  * 
- * where s are the meaningful size bits and a/f is set iff the
- * block is allocated (0=a/1=f). Every block follows the form:
+ * where s are the meaningful size bits, f is set iff the block is
+ * free and pf is set iff the block before it is free (0=a/1=f for
+ * both). g is set iff an allocated block was grown by mm_realloc(),
+ * or a free block is on the purge list. Only free blocks have a
+ * footer, holding their size and f, so allocated blocks lose just
+ * one word to overhead and PREV_BLKP may only be used when pf is
+ * set. Blocks follow the form:
  * 
- *      31             0
- *      ----------------
- *     | Header
- *      ------------------
- *     | prev_free_block  \
- *      ----------------   | - Payload when not free
- *     | next_free_block  /
- *      ------------------
- *     | Footer
+ *      31             0               31             0
+ *      ----------------                ----------------
+ *     | Header                        | Header
+ *      ------------------              ----------------
+ *     | next_free_block  \            |
+ *      ----------------   | - Free    | Payload
+ *     | prev_free_block  /            |
+ *      ------------------              ----------------
+ *     | Footer                         Allocated
  *      ----------------
  * 
  * Due to the size of the header and the bytes required to store
  * the next and previous pointers, the minsize of a free block MUST
- * be 4 words, or 2 DWORDS (16 bytes)
+ * be 4 words, or 2 DWORDS (16 bytes). Words stay 4 bytes in a 64-bit
+ * build: sizes fit in 32 bits as the heap is below 4 GiB, and the
+ * free list links are 32 bit offsets from the start of the heap
+ * rather than pointers, so the 16 byte minimum holds there too.
+ * Block sizes are a multiple of ALIGNSIZE, 8 or 16 bytes.
  * 
- * The list has the following form:
+ * Free blocks are kept in NUM_CLASSES NULL terminated lists. List i
+ * holds blocks whose size is in [MINSIZE*2^i, MINSIZE*2^(i+1)), and
+ * the last list holds everything larger. Blocks are pushed on the
+ * front of their list, and freed blocks are merged with their
+ * neighbours by reading the boundary tags of PREV_BLKP/NEXT_BLKP, so
+ * mm_free() and the split in place() never walk a list.
+ *
+ * Built with USE_TLSF the lists are replaced by a two-level
+ * segregated fit index: bins over power of two ranges split
+ * linearly, with bitmaps of the non empty bins so that find_fit()
+ * costs two find-first-set operations however fragmented the heap.
+ *
+ * Built with USE_TREE they are replaced by a treap keyed by
+ * (size, address), giving exact best fit with address ordered
+ * ties in logarithmic expected time.
+ *
+ * Built with USE_SCAN they are replaced by a contiguous array of
+ * free block sizes beside one of their offsets, which find_fit()
+ * scans with SIMD compares without touching the blocks themselves.
+ *
+ * Unless USE_HEADROOM is "0", blocks mm_realloc() grows a second
+ * time get headroom past the requested size, so the steps after are
+ * served within the block. How much adapts to how often it is used.
+ *
+ * mm_memalign() places a block at an aligned spot inside a free
+ * block and splits the slack in front of it off as a free block, as
+ * slab_new() does for its page aligned slabs.
+ *
+ * mm_malloc_batch() carves a run of same sized blocks out of one free
+ * block, and mm_free_batch() frees blocks in address order so that a
+ * run of neighbours becomes one free block before it is coalesced.
+ *
+ * mm_calloc() only zeroes bytes that may be dirty. Heap memory from
+ * zero_lo up, past both what memlib handed out before mm_init() and
+ * every block allocated since, is zero but for the tags and links of
+ * the free blocks there. coalesce() clears those when blocks merge so
+ * that the span stays zero.
+ *
+ * Requests of MMAP_THRESHOLD bytes or more get a mapping of their own
+ * from mem_map(), with the payload ALIGNSIZE bytes in and the mapping
+ * size in the header before it. mm_free() unmaps them straight away
+ * and mm_realloc() resizes them with mem_remap(). They are told apart
+ * from heap blocks by their address.
+ *
+ * When frees leave a free block of more than TRIM_THRESHOLD bytes at
+ * the end of the heap, trim_heap() lowers the break to give all but
+ * CHUNKSIZE of it back.
+ *
+ * Pages inside free blocks elsewhere are purged, given back with
+ * mem_purge(), once they have been free for PURGE_DECAY mallocs and
+ * frees. Each heap page has the op count when it last became free
+ * and a purged flag, kept beside the heap so free blocks need no
+ * room for them. Free blocks with whole pages inside are linked on
+ * a purge list, after their free list links, until none of their
+ * pages is left to purge, so purge_sweep() looks at those blocks
+ * alone rather than walking the heap. A purged page may read back
+ * as zero or as what it held, so only the zero_lo rule is relied on
+ * for its contents, which holds either way as tags and links are
+ * never purged.
+ *
+ * Unless FAST_MAX is "0", freed blocks of up to FAST_MAX bytes are
+ * not coalesced straight away but pushed on a LIFO fast bin for their
+ * exact size, still marked allocated, so the next malloc of that size
+ * pops one back without a search or a split. The bins are coalesced
+ * together once they hold FAST_LIMIT bytes, or before the heap would
+ * grow for a request that nothing else fits.
+ *
+ * The free block at the end of the heap, if any, is the wilderness.
+ * It is kept out of the free block index so that requests only cut
+ * into it when no other free block fits, and it stays one large
+ * block the heap can grow or trim. When it is too small the heap is
+ * extended by just the shortfall, which coalesce() merges into it.
+ *
+ * When nothing fits, the heap grows by a step that doubles while
+ * requests keep missing and shrinks back when they stop, so a heap
+ * filling up quickly makes few calls to mem_sbrk().
+ *
+ * Unless USE_SLAB is "0", requests of up to SLAB_MAX bytes never
+ * reach the heap blocks above. They are served from page aligned
+ * slabs of same sized objects without headers, see slab_malloc().
+ *
+ * Everything above is kept per arena. An arena has its own heap in
+ * a memlib region, with its own break, free block index, fast bins,
+ * slabs and a lock. Each thread is given an arena on its first call
+ * and allocates from it under its lock, so threads on different
+ * arenas never wait on each other. Until the process starts a
+ * second thread there is no one to wait on, and the locks are
+ * skipped. The regions are MAX_HEAP bytes apart, so a block is
+ * freed to the arena it came from by dividing its offset from the
+ * first region. Internal functions work on the current arena, the
+ * one the calling thread holds.
+ *
+ * Unless TCACHE_MAX is "0", each thread also keeps a cache of the
+ * small blocks it frees, per block size, which serves its mallocs
+ * of those sizes without taking a lock, see tcache_get().
+ *
+ * The heap has the following form:
  *
  * begin                                                         end
  * heap                                                          heap  
  *  -----------------------------------------------------------------   
- * |  key   | hdr(8:a) |   pad   | zero or more usr blks | hdr(8:a) |
+ * |  key   | hdr(8:a) | ftr(8:a) | zero or more usr blks | hdr(0:a) |
  *  -----------------------------------------------------------------
- *    four  | prologue |  four   |                       | epilogue |
- *    bytes | block    |  bytes  |                       | block    |
+ *    one   |       prologue      |                       | epilogue |
+ *    word  |        block        |                       | block    |
  *
  */
 
@@ -45,8 +150,28 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "mm.h"
 #include "memlib.h"
+#include "mmcopy.h"
+#include "config.h"
+
+/* glibc says whether the process has only ever had one thread */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 32))
+#include <sys/single_threaded.h>
+#define SINGLE_THREADED()	(__libc_single_threaded)
+#else
+#define SINGLE_THREADED()	0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86	1
+#else
+#define HAVE_X86	0
+#endif
 
 
 /* Team structure */
@@ -67,518 +192,2944 @@ team_t team = {
 /* You can add more macros and constants in this section */
 #define WSIZE       4       /* word size (bytes) */  
 #define DSIZE       8       /* doubleword size (bytes) */
+#define ALIGNSIZE	ALIGNMENT	/* block sizes and payloads are multiples of this */
 #define CHUNKSIZE  (1<<12)  /* initial heap size (bytes) */
-#define OVERHEAD    8       /* overhead of headers (bytes) */
+#define OVERHEAD    4       /* overhead of allocated block header (bytes) */
 #define MINSIZE		16		/* min size of block for overhead + explicit list */
 
+/*
+ * Free block index, chosen at build time. Set USE_TLSF to "1" for
+ * two-level segregated fit, USE_TREE to "1" for a best fit tree or
+ * USE_SCAN to "1" for a SIMD scanned size array, otherwise
+ * segregated size class lists are used,
+ * e.g. make clean && make MMFLAGS=-DUSE_TLSF=1
+ */
+#ifndef USE_TLSF
+#define USE_TLSF	0
+#endif
+#ifndef USE_TREE
+#define USE_TREE	0
+#endif
+#ifndef USE_SCAN
+#define USE_SCAN	0
+#endif
+#if USE_TLSF + USE_TREE + USE_SCAN > 1
+#error "Set at most one of USE_TLSF, USE_TREE and USE_SCAN"
+#endif
+
+/*
+ * Realloc headroom, set USE_HEADROOM to "0" to grow blocks to the
+ * exact size asked for. Blocks get 1/2^shift of their size extra,
+ * with shift adapted between the limits below.
+ */
+#ifndef USE_HEADROOM
+#define USE_HEADROOM	1
+#endif
+
+#define HEADROOM_MIN_SHIFT	1	/* most headroom, half the block */
+#define HEADROOM_MAX_SHIFT	5	/* least headroom, 1/32 of the block */
+#define HEADROOM_WINDOW		16	/* headroom grants between adaptations */
+
+/*
+ * Free blocks the size class list search looks at before it gives
+ * up, "0" for no limit. Can be changed at run time with
+ * mm_probe_limit().
+ */
+#ifndef PROBE_LIMIT
+#define PROBE_LIMIT	0
+#endif
+
+/*
+ * Placement, see mm_fit_use() and mm_split_use(). Good fit takes a
+ * block at most 1/2^GOOD_FIT_SHIFT larger than the request, and
+ * back splitting applies to blocks of up to SPLIT_SMALL bytes.
+ */
+#define GOOD_FIT_SHIFT	3
+#define SPLIT_SMALL		1024
+
+/*
+ * Small object tier, set USE_SLAB to "0" to serve every request
+ * from the boundary tag heap.
+ */
+#ifndef USE_SLAB
+#define USE_SLAB	1
+#endif
+
+/*
+ * Requests of at least this many bytes are mapped on their own,
+ * set it above MAX_HEAP to keep every block in the heap
+ */
+#ifndef MMAP_THRESHOLD
+#define MMAP_THRESHOLD	(128*1024)
+#endif
+
+/*
+ * A free block at the end of the heap larger than TRIM_THRESHOLD
+ * is shrunk to CHUNKSIZE and the rest given back to memlib
+ */
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD	(128*1024)
+#endif
+
+/*
+ * Heap growth, see grow_size(). Extensions start at GROW_MIN bytes
+ * and double while they come less than GROW_WINDOW mallocs and frees
+ * apart, up to 1/2^GROW_MAX_SHIFT of the heap, and halve back while
+ * more than 1/2^GROW_FREE_SHIFT of the heap is free. Set GROW_WINDOW
+ * to "0" to always grow by GROW_MIN. mm_grow_policy() sets the first
+ * three per arena.
+ */
+#ifndef GROW_MIN
+#define GROW_MIN	CHUNKSIZE
+#endif
+#ifndef GROW_MAX_SHIFT
+#define GROW_MAX_SHIFT	6
+#endif
+#ifndef GROW_WINDOW
+#define GROW_WINDOW	64
+#endif
+#ifndef GROW_FREE_SHIFT
+#define GROW_FREE_SHIFT	2
+#endif
+
+/*
+ * Fast bins, freed blocks of up to FAST_MAX bytes are held for reuse
+ * at their size until the bins hold FAST_LIMIT bytes. Set FAST_MAX
+ * to "0" to coalesce every block as it is freed.
+ */
+#ifndef FAST_MAX
+#define FAST_MAX	4096
+#endif
+#ifndef FAST_LIMIT
+#define FAST_LIMIT	(256*1024)
+#endif
+
+/*
+ * Free heap pages are purged after PURGE_DECAY mallocs and frees,
+ * checked every PURGE_DECAY/4 of them. Set it to "0" to never purge.
+ */
+#ifndef PURGE_DECAY
+#define PURGE_DECAY	8192
+#endif
+#define PURGE_PAGE	(1<<12)		/* bytes per purged page */
+
+/*
+ * Set MM_DEBUG to "1" to check what callers tell the allocator,
+ * such as the size passed to mm_free_sized().
+ */
+#ifndef MM_DEBUG
+#define MM_DEBUG	0
+#endif
+
+/*
+ * Arenas, each a heap in a memlib region of its own. Threads are
+ * given them round-robin, or by a hash of the thread if ARENA_HASH
+ * is set to "1". Either way the first thread gets the arena in
+ * region 0, the heap mem_heap_lo() and mem_heap_hi() describe.
+ */
+#ifndef MAX_ARENAS
+#define MAX_ARENAS	MAX_REGIONS
+#endif
+#ifndef ARENA_HASH
+#define ARENA_HASH	0
+#endif
+#if MAX_ARENAS > MAX_REGIONS
+#error "MAX_ARENAS is more than memlib has regions"
+#endif
+
+/*
+ * Thread caches, each thread holds up to TCACHE_BYTES of the blocks
+ * of up to TCACHE_MAX bytes it frees, at most TCACHE_COUNT of a size,
+ * and moves them to and from the arenas TCACHE_BATCH at a time. Set
+ * TCACHE_MAX to "0" to take an arena lock on every call.
+ */
+#ifndef TCACHE_MAX
+#define TCACHE_MAX	1024
+#endif
+#ifndef TCACHE_BYTES
+#define TCACHE_BYTES	(64*1024)
+#endif
+#define TCACHE_COUNT	16
+#define TCACHE_BATCH	8
+#define TCACHE_BINS		(TCACHE_MAX / ALIGNSIZE + 1)
+
+#define SLAB_SIZE	(1<<12)					/* bytes per slab, also its alignment */
+#define SLAB_MAX	256						/* largest request served from a slab */
+#define NUM_SLAB_CLASSES	14				/* object sizes, see slab_sizes */
+#define SLAB_MAP_WORDS	((SLAB_SIZE / ALIGNSIZE + 31) / 32)	/* free bitmap words per slab */
+
+#define NUM_CLASSES	20		/* number of segregated free lists */
+
+#define SL_BITS		4						/* log2 of bins per first level */
+#define SL_COUNT	(1 << SL_BITS)			/* bins per first level */
+#define SMALL_BLOCK	(SL_COUNT * ALIGNSIZE)	/* sizes below share first level 0 */
+#define FL_COUNT	26						/* first levels, enough for sizes below 4 GiB */
+
+#define SCAN_CHUNK	64						/* size array slots per chunk */
+#define SCAN_SLOTS	((MAX_HEAP / MINSIZE + SCAN_CHUNK - 1) / SCAN_CHUNK * SCAN_CHUNK)	/* most free blocks */
+
 #define MAX(x, y)		((x) > (y) ? (x) : (y))  
+#define MIN(x, y)		((x) < (y) ? (x) : (y))
 
-/* Pack a size and allocated bit into a word */
-#define PACK(size, alloc)	((size) | (alloc))
+/* Index of the lowest/highest set bit of a non zero x */
+#define FFS(x)			(__builtin_ctz(x))
+#define FLS(x)			((int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl(x))
+
+/* Header bits, both set when the block they describe is free */
+#define FREE_BIT		0x1		/* this block is free */
+#define PFREE_BIT		0x2		/* previous block is free */
+#define GROWN_BIT		0x4		/* allocated block was grown by mm_realloc */
+#define PURGE_BIT		0x4		/* free block is on the purge list */
+
+/* Pack a size and free bits into a word */
+#define PACK(size, free)	((size) | (free))
 
 /* Read and write a word at address p */
-#define GET(p)			(*(size_t *)(p))
-#define PUT(p, val)		(*(size_t *)(p) = (val))  
+#define GET(p)			(*(unsigned int *)(p))
+#define PUT(p, val)		(*(unsigned int *)(p) = (val))
 
-/* Read the size and allocated fields from address p */
+/* Read the size and free fields from address p */
 #define GET_SIZE(p)		(GET(p) & ~0x7)
-#define GET_ALLOC(p)	(GET(p) & 0x1)
+#define GET_FREE(p)		(GET(p) & FREE_BIT)
+#define GET_PFREE(p)	(GET(p) & PFREE_BIT)
+#define GET_GROWN(p)	(GET(p) & GROWN_BIT)
+
+/* Set or clear the previous block free bit of the header at address p. The
+   header may be of an allocated block that a thread cache reads without the
+   lock, so it is stored whole by a relaxed atomic store, a plain move. */
+#define SET_PFREE(p)	__atomic_store_n((unsigned int *)(p), GET(p) | PFREE_BIT, __ATOMIC_RELAXED)
+#define CLR_PFREE(p)	__atomic_store_n((unsigned int *)(p), GET(p) & ~PFREE_BIT, __ATOMIC_RELAXED)
+
+/* Mark the allocated block with header at address p as grown */
+#define SET_GROWN(p)	PUT(p, GET(p) | GROWN_BIT)
 
-/* Given block ptr bp, compute address of its header and footer*/
+/* Given block ptr bp, compute address of its header and footer (free blocks only) */
 #define HDRP(bp)		((char *)(bp) - WSIZE)
 #define FTRP(bp)		((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
 
-/* Given block ptr bp, compute address of next and prev blocks */
+/* Given block ptr bp, compute address of next and prev blocks (prev only if GET_PFREE) */
 #define NEXT_BLKP(bp)	((char *)(bp) + GET_SIZE((char *)(bp) - WSIZE))
 #define PREV_BLKP(bp)	((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE))
 
+/* Convert between a free block ptr (bp) and its offset from the heap start, 0 for NULL */
+#define TO_LINK(bp)		((bp) == NULL ? 0 : (unsigned int)((char *)(bp) - arena->heap_lo))
+#define TO_PTR(l)		((l) == 0 ? NULL : arena->heap_lo + (l))
+
+/* Next/previous free list links (offsets) in free area of a free block (bp) */
+#define NEXT_LINK(bp)			(*(unsigned int *)(bp))
+#define PREV_LINK(bp)			(*(unsigned int *)((char *)(bp) + WSIZE))
+
+/* Next/previous purge list links (offsets) of a free block (bp), after its free list links */
+#define PURGE_NEXT(bp)			(*(unsigned int *)((char *)(bp) + 2*WSIZE))
+#define PURGE_PREV(bp)			(*(unsigned int *)((char *)(bp) + 3*WSIZE))
+
 /* Gets next/previous free list pointers in free area of a free block (bp) */
-#define GET_NEXT_FREE(bp)		(*(char **)(bp))
-#define GET_PREV_FREE(bp)		(*(char **)(bp + WSIZE))
+#define GET_NEXT_FREE(bp)		TO_PTR(NEXT_LINK(bp))
+#define GET_PREV_FREE(bp)		TO_PTR(PREV_LINK(bp))
 
 /* Puts next/previous free list pointers (fp) in free area of a free block (bp) */
-#define SET_NEXT_FREE(bp, fp)	(GET_NEXT_FREE(bp) = (fp))
-#define SET_PREV_FREE(bp, fp)	(GET_PREV_FREE(bp) = (fp))
+#define SET_NEXT_FREE(bp, fp)	(NEXT_LINK(bp) = TO_LINK(fp))
+#define SET_PREV_FREE(bp, fp)	(PREV_LINK(bp) = TO_LINK(fp))
+
+/* Growth policy of a heap and its state */
+typedef struct {
+	size_t min;				/* first and smallest step (bytes) */
+	int max_shift;			/* steps stay within 1/2^max_shift of the heap */
+	unsigned int window;	/* extensions this many ops apart double the step */
+	size_t step;			/* bytes to grow by when nothing fits */
+	unsigned int last;		/* op_clock at the last extension */
+} grow_t;
+
+/* Placement policies of the size class lists, see mm_fit_use() */
+typedef enum { FIT_FIRST, FIT_NEXT, FIT_BEST, FIT_GOOD, FIT_ADDRESS, NUM_FITS } fit_t;
+
+/* Slab header at the start of every slab */
+typedef struct slab_t {
+	struct slab_t *next;					/* next slab of the class with free objects */
+	struct slab_t *prev;					/* previous slab of the class */
+	unsigned short size;					/* object size (bytes) */
+	unsigned short nobjs;					/* objects in the slab */
+	unsigned short nfree;					/* free objects in the slab */
+	unsigned int bitmap[SLAB_MAP_WORDS];	/* bit set iff the object is free */
+} slab_t;
+
+/* Bytes before the first object of a slab */
+#define SLAB_HDR		((sizeof(slab_t) + ALIGNSIZE - 1) / ALIGNSIZE * ALIGNSIZE)
+
+/* Objects of size bytes that fit between the slab header and the next block's header */
+#define SLAB_NOBJS(size)	((SLAB_SIZE - OVERHEAD - SLAB_HDR) / (size))
+
+/* Given any ptr bp in the heap, compute the index of its page in slab_map */
+#define SLAB_PAGE(bp)	((uintptr_t)(bp) / SLAB_SIZE - (uintptr_t)arena->heap_lo / SLAB_SIZE)
+
+/* Is bp inside a slab, and if so the slab holding it */
+#define IS_SLAB(bp)		(arena->slab_map[SLAB_PAGE(bp)])
+#define SLAB_OF(bp)		((slab_t *)((uintptr_t)(bp) / SLAB_SIZE * SLAB_SIZE))
+
+/* Bytes to map for a block of size bytes of payload */
+#define MAP_SIZE(size)	(((size) + ALIGNSIZE + mem_pagesize() - 1) / mem_pagesize() * mem_pagesize())
+
+/* Is bp outside the heaps of all arenas, in a mapping of its own */
+#define IS_MAPPED(bp)	((char *)(bp) < arena_base || (char *)(bp) >= arena_base + (size_t)MAX_ARENAS * MAX_HEAP)
+
+/* Given a ptr bp in the heap of an arena, the arena */
+#define ARENA_OF(bp)	(&arenas[((char *)(bp) - arena_base) / MAX_HEAP])
+
+/* Given any ptr p in the heap, compute the index of its page for purging */
+#define PURGE_INDEX(p)	((size_t)((char *)(p) - arena->heap_lo) / PURGE_PAGE)
 
 /* $end mallocmacros */
 
 /* Global variables */
-static char *heap_listp;  /* pointer to first block */  
-static char *free_listp;  /* pointer to free list */
+
+/* An arena: a heap in a memlib region of its own, with its free block
+   index and caches, used by one thread at a time under its lock */
+typedef struct __attribute__((aligned(64))) {
+	pthread_mutex_t lock;     /* held by the thread working on the arena */
+	int id;                   /* index in arenas, also the memlib region of its heap */
+	unsigned int gen;         /* mm_gen when it was last set up */
+	mm_counters_t counters;   /* event counters, see mm.h */
+	char *heap_listp;  /* pointer to first block */  
+	char *heap_lo;     /* first byte of the heap, base of the free list links */
+	char *zero_lo;     /* bytes from here on are zero but for free block tags and links */
+	char *wild;        /* free block at the end of the heap, NULL if the last block is allocated */
+#if USE_HEADROOM
+	int headroom_shift;  /* headroom is 1/2^headroom_shift of a block */
+	int window_grants;   /* headroom grants since the last adaptation */
+	int window_hits;     /* reallocs served from headroom since then */
+#endif
+#if !USE_TLSF && !USE_TREE && !USE_SCAN
+	char *seg_listp[NUM_CLASSES];  /* heads of the segregated free lists */
+	char *rover;                   /* where the next fit search starts */
+#elif USE_TLSF
+	unsigned int fl_bitmap;                  /* non empty first levels */
+	unsigned int sl_bitmap[FL_COUNT];        /* non empty bins per first level */
+	char *tlsf_listp[FL_COUNT][SL_COUNT];    /* heads of the bins */
+#elif USE_SCAN
+	unsigned int *scan_size;  /* free block sizes, mapped by scan_map() */
+	unsigned int *scan_link;  /* ... and their offsets */
+	unsigned int *scan_max;   /* largest size per chunk */
+	size_t scan_count;        /* slots in use */
+#else
+	unsigned int tree_root;  /* link to the root of the size ordered tree */
+#endif
+#if FAST_MAX
+	char *fast_bins[FAST_MAX / ALIGNSIZE + 1];  /* freed blocks not yet coalesced, per size */
+	size_t fast_bytes;                          /* bytes held in them */
+#endif
+	size_t free_bytes;        /* bytes in the free block index, not the wilderness */
+	unsigned int op_clock;    /* mallocs and frees since the arena was set up */
+	grow_t heap_grow;         /* growth policy of the heap, kept across mm_init() */
+#if PURGE_DECAY
+	unsigned int last_sweep;  /* op_clock at the last purge_sweep() */
+	unsigned int purge_head;  /* link to the first free block on the purge list */
+	unsigned int page_freed[MAX_HEAP / PURGE_PAGE + 2];   /* op_clock when each page last became free */
+	unsigned char page_purged[MAX_HEAP / PURGE_PAGE + 2]; /* set for pages purged since */
+#endif
+#if USE_SLAB
+	slab_t *slab_listp[NUM_SLAB_CLASSES];  /* slabs with free objects per class */
+	unsigned char slab_map[MAX_HEAP / SLAB_SIZE + 2];  /* set for heap pages that are slabs */
+#endif
+} arena_t;
+
+static arena_t arenas[MAX_ARENAS];   /* set up on first use after each mm_init() */
+static __thread arena_t *arena;      /* arena the calling thread holds, NULL outside a call */
+static __thread arena_t *home;       /* arena assigned to the calling thread, NULL before its first call */
+#if ARENA_HASH
+static int arena_taken;              /* set once a thread has been given arenas[0] */
+#else
+static unsigned int arena_next;      /* arenas assigned so far, round-robin */
+#endif
+static unsigned int mm_gen;          /* mm_init() calls so far */
+static char *arena_base;             /* first byte of the region of arenas[0] */
+static pthread_once_t arenas_once = PTHREAD_ONCE_INIT;  /* see arenas_setup() */
+#if TCACHE_MAX
+
+/* A thread's cache of freed blocks, a stack per block size */
+typedef struct {
+	unsigned int gen;                       /* mm_gen its blocks are from */
+	size_t bytes;                           /* bytes held in all stacks */
+	unsigned char count[TCACHE_BINS];       /* blocks per stack */
+	void *bins[TCACHE_BINS][TCACHE_COUNT];  /* the stacks, newest block last */
+} tcache_t;
+
+static __thread tcache_t tcache;     /* cache of the calling thread */
+static pthread_key_t tcache_key;     /* flushes the cache of a thread as it exits */
+#endif
+#if !USE_TLSF && !USE_TREE && !USE_SCAN
+static fit_t fit_policy = FIT_FIRST;  /* see mm_fit_use() */
+
+/* Names of the policies, in fit_t order */
+static const char *fit_names[NUM_FITS] = { "first", "next", "best", "good", "address" };
+#elif USE_SCAN
+static int (*scan_chunk)(const unsigned int *p, unsigned int need);  /* widest scan the CPU has */
+#endif
+static int probe_limit = PROBE_LIMIT;  /* see mm_probe_limit() */
+static int split_back;                 /* see mm_split_use() */
+#if USE_SLAB
+
+/* Object size of each slab class (ALIGNSIZE units), those above SLAB_MAX go unused */
+static const unsigned char slab_sizes[NUM_SLAB_CLASSES] = {
+	1, 2, 3, 4, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32
+};
+#endif
 
 /* function prototypes for internal helper routines */
+static int arena_init(void);
+static arena_t *arena_enter(arena_t *a);
+static void arena_leave(void);
+static arena_t *arena_of(void *bp);
+static void arenas_setup(void);
+static void *arena_malloc(size_t size);
+static void *arena_memalign(size_t align, size_t size);
+static void *arena_calloc(size_t nmemb, size_t size);
+static size_t arena_malloc_batch(size_t size, size_t n, void **out);
+static void arena_free(void *bp);
+static void arena_free_sized(void *bp, size_t size);
+static void arena_free_batch(void **ptrs, size_t n);
+static void *arena_realloc(void *ptr, size_t size);
+static void check_arena(int verbose);
+#if TCACHE_MAX
+static size_t tcache_size(size_t size);
+static size_t tcache_block_size(void *bp);
+#if !MM_DEBUG
+static size_t tcache_sized_size(void *bp, size_t size);
+#endif
+static void tcache_reset(tcache_t *tc);
+static void *tcache_get(size_t bsize);
+static int tcache_put(void *bp, size_t bsize);
+static void tcache_flush(tcache_t *tc, int bin, int n);
+static void tcache_exit(void *p);
+#endif
 static void *extend_heap(size_t words);
 static void place(void *bp, size_t asize);
+static void *place_split(void *bp, size_t asize);
+static void place_batch(void *bp, size_t asize, size_t n, void **out);
 static void *find_fit(size_t asize);
+static void *wild_fit(size_t asize);
 static void printblock(void *bp);
-static void mm_memcpy(void * dest, void * src);
+static void *coalesce(void *bp);
+static size_t adjust_size(size_t size);
+static void realloc_trim(void *bp, size_t asize);
+static void *realloc_grow(void *bp, size_t asize);
+static void mark_dirty(void *bp);
+static void trim_heap(void);
+static inline void op_tick(void);
+static size_t grow_size(grow_t *g, size_t need);
+static inline void purge_stamp(char *lo, size_t size);
+#if PURGE_DECAY
+static void purge_sweep(void);
+static void purge_link(void *bp);
+static void purge_unlink(void *bp);
+static int check_purge(void);
+#endif
+static void clear_tags(char *p);
+#if USE_HEADROOM
+static void headroom_adapt(void);
+#endif
+static void clear_lists(void);
+static int check_lists(void);
+#if USE_SCAN
+static void scan_pick(void);
+static int scan_map(void);
+#endif
 static void add_to_list(void* bp);
 static void remove_from_list(void* bp);
+static void add_free(void *bp);
+static void remove_free(void *bp);
+static void free_block(void *bp);
+#if FAST_MAX
+static void *fast_pop(size_t asize);
+static void fast_push(void *bp);
+static void fast_consolidate(void);
+static void check_fast(void);
+#endif
+static void *place_aligned(void *bp, size_t asize, size_t align);
+static void *find_fit_aligned(size_t asize, size_t align);
+static void *malloc_aligned(size_t asize, size_t align);
+static int ptr_cmp(const void *a, const void *b);
+static void *map_malloc(size_t size);
+static void map_free(void *bp);
+static void *map_realloc(void *bp, size_t size);
+#if MM_DEBUG
+static int check_sized(void *bp, size_t size);
+#endif
+#if USE_SLAB
+static int slab_class(size_t size);
+static void *slab_malloc(size_t size);
+static void slab_free(void *bp);
+static void check_slab(void *bp);
+static void check_slabs(void);
+#endif
 
 /* 
  * mm_init - Initialize the memory manager 
+ *
+ * Every arena is set up again on its first use after this, the one
+ * of the calling thread straight away. No other thread may be in
+ * the package meanwhile.
  */
 /* $begin mminit */
 int mm_init(void) 
 {
-	/* create the initial empty heap */
-	if ((heap_listp = mem_sbrk(4*WSIZE)) == NULL){
-		return -1;
-	}
-	PUT(heap_listp, KEY);						/* alignment padding */
-	PUT(heap_listp+WSIZE, PACK(DSIZE, 0));		/* prologue header */ 
-	PUT(heap_listp+DSIZE, PACK(0, 0));			/* empty word*/ 
-	PUT(heap_listp+DSIZE+WSIZE, PACK(0, 0));	/* epilogue header */
-	heap_listp += (DSIZE);						/* move pointer to user blocks */
-	free_listp = NULL;							/* clear free list */
+	pthread_once(&arenas_once, arenas_setup);
+	arena_base = mem_region_lo(0);
+	mm_gen++;
 
-	/* Extend the empty heap with a free block of CHUNKSIZE bytes 
-	 * point free list at the returned block
-	*/
-	if (extend_heap(CHUNKSIZE/WSIZE) == NULL){
+	if (arena_enter(NULL) == NULL) {
 		return -1;
 	}
-
-	return (int) heap_listp;
+	arena_leave();
+	return 0;
 }
 /* $end mminit */
 
-/* 
- * mm_malloc - Allocate a block with at least size bytes of payload 
+/*
+ * arenas_setup - Initializes the arena locks and picks the loops
+ *         that depend on the CPU, once before any arena is used
  */
-/* $begin mmmalloc */
-void *mm_malloc(size_t size) 
+static void arenas_setup(void)
 {
-	size_t asize;      /* adjusted block size */
-	size_t extendsize; /* amount to extend heap if no fit */
-	char *bp;
-
-	/* Ignore spurious requests */
-	if (size <= 0){
-		return NULL;
+	for (int i = 0; i < MAX_ARENAS; i++) {
+		pthread_mutex_init(&arenas[i].lock, NULL);
+		arenas[i].id = i;
+		arenas[i].heap_grow = (grow_t){ GROW_MIN, GROW_MAX_SHIFT, GROW_WINDOW, GROW_MIN, 0 };
 	}
+	mm_memcpy_name();	/* pick the copy loop before threads race to */
+#if USE_SCAN
+	scan_pick();
+#endif
+#if TCACHE_MAX
+	pthread_key_create(&tcache_key, tcache_exit);
+#endif
+}
 
-	/* Adjust block size to include overhead and alignment reqs. */
-	if (size <= DSIZE){
-		asize = MINSIZE;
-	} else{
-		asize = DSIZE * ((size + (OVERHEAD) + (DSIZE-1)) / DSIZE);
+/*
+ * arena_init - Sets up the current arena with an empty heap
+ */
+static int arena_init(void)
+{
+	/* create the initial empty heap */
+	if ((arena->heap_listp = mem_sbrk_region(arena->id, 4*WSIZE)) == (void *)-1){
+		return -1;
 	}
-
-	/* Search the free list for a fit */
-	if ((bp = find_fit(asize)) != NULL) {
-		place(bp, asize);
-		//mm_checkheap(0);
-		return bp;
+	arena->heap_lo = arena->heap_listp;
+	arena->zero_lo = mem_region_fresh(arena->id);
+	arena->wild = NULL;
+	PUT(arena->heap_listp, KEY);						/* alignment padding */
+	PUT(arena->heap_listp+WSIZE, PACK(DSIZE, 0));		/* prologue header */ 
+	PUT(arena->heap_listp+DSIZE, PACK(DSIZE, 0));		/* prologue footer */
+	PUT(arena->heap_listp+DSIZE+WSIZE, PACK(0, 0));	/* epilogue header */
+	arena->heap_listp += (DSIZE);						/* move pointer to user blocks */
+#if USE_SCAN
+	if (arena->scan_size == NULL && scan_map() == -1) {
+		return -1;
 	}
-
-	/* No fit found. Get more memory and place the block */
-	extendsize = MAX(asize,CHUNKSIZE);
-	if ((bp = extend_heap(extendsize/WSIZE)) == NULL) {
-		printf("mm_malloc = NULL\n");
-		return NULL;
+#endif
+	clear_lists();								/* clear free lists */
+	memset(&arena->counters, 0, sizeof(arena->counters));
+#if USE_HEADROOM
+	arena->headroom_shift = (HEADROOM_MIN_SHIFT + HEADROOM_MAX_SHIFT) / 2;
+	arena->counters.headroom_shift = arena->headroom_shift;
+	arena->window_grants = arena->window_hits = 0;
+#endif
+#if FAST_MAX
+	memset(arena->fast_bins, 0, sizeof(arena->fast_bins));
+	arena->fast_bytes = 0;
+#endif
+	arena->free_bytes = 0;
+	arena->op_clock = 0;
+	arena->heap_grow.step = arena->heap_grow.min;
+	arena->heap_grow.last = 0;
+#if PURGE_DECAY
+	arena->last_sweep = 0;
+	arena->purge_head = 0;
+	memset(arena->page_freed, 0, sizeof(arena->page_freed));
+	memset(arena->page_purged, 0, sizeof(arena->page_purged));
+#endif
+#if USE_SLAB
+	memset(arena->slab_listp, 0, sizeof(arena->slab_listp));	/* no slabs yet */
+	memset(arena->slab_map, 0, sizeof(arena->slab_map));
+#endif
+
+	/* Extend the empty heap with a free block of CHUNKSIZE bytes */
+	if (extend_heap(CHUNKSIZE/WSIZE) == NULL){
+		return -1;
 	}
 
-	place(bp, asize);
-
-	//mm_checkheap(0);
-
-	return bp;
-} 
-/* $end mmmalloc */
+	arena->gen = mm_gen;
+	return 0;
+}
 
-/* 
- * mm_free - Free a block 
- * 
- * Given the alloced bit is set, tries to coalesce which
- * frees be default, else OR's header and footer with 1,
- * else print error to stderr.
+/*
+ * arena_enter - Locks a, or the arena of the calling thread if a is
+ *         NULL, and makes it the current arena, setting it up if it
+ *         has not been since mm_init(). Returns the arena, or NULL
+ *         if it could not be set up.
  */
-/* $begin mmfree */
-void mm_free(void *bp)
+static arena_t *arena_enter(arena_t *a)
 {
-	if(bp == NULL){
-		fprintf(stderr, "mm_free(): null pointer");
-		return;
+	if (a == NULL) {
+		if (home == NULL) {
+#if ARENA_HASH
+			uint64_t h = (uint64_t)(uintptr_t)pthread_self() * 0x9e3779b97f4a7c15ULL;
+			home = &arenas[(h >> 32) % MAX_ARENAS];
+			if (!__atomic_exchange_n(&arena_taken, 1, __ATOMIC_RELAXED)) {
+				home = &arenas[0];
+			}
+#else
+			home = &arenas[__atomic_fetch_add(&arena_next, 1, __ATOMIC_RELAXED) % MAX_ARENAS];
+#endif
+		}
+		a = home;
+	}
+	if (!SINGLE_THREADED()) {
+		pthread_mutex_lock(&a->lock);
+	}
+	arena = a;
+	if (a->gen != mm_gen && arena_init() == -1) {
+		arena_leave();
+		return NULL;
 	}
+	return a;
+}
 
-	// If allocated, free
-	if(!GET_ALLOC(HDRP(bp))){
-		*HDRP(bp) |= 1;
-		*FTRP(bp) |= 1;
-		add_to_list(bp);
-	} else {
-		fprintf(stderr, "mm_free(): memory not alloced or corrupted");
-		return;
+/*
+ * arena_leave - Unlocks the current arena
+ *
+ * A thread can only be started between calls, so the process is
+ * single threaded here just when it was in arena_enter().
+ */
+static void arena_leave(void)
+{
+	if (!SINGLE_THREADED()) {
+		pthread_mutex_unlock(&arena->lock);
 	}
-		
+	arena = NULL;
 }
 
-/* $end mmfree */
+/*
+ * arena_of - Returns the arena block bp came from, NULL if it is
+ *         NULL or has a mapping of its own
+ */
+static arena_t *arena_of(void *bp)
+{
+	return (bp == NULL || IS_MAPPED(bp)) ? NULL : ARENA_OF(bp);
+}
 
 /*
- * mm_realloc - naive implementation of mm_realloc
- * 
- * Given an alloced pointer, get size, add to that size, pass to malloc to
- * get new block.
- * 
+ * mm_probe_limit - Sets how many free blocks a fit search may look at,
+ *         0 for no limit, and returns the previous limit. It holds
+ *         across mm_init() calls. A negative n only returns it.
+ *
+ * With a limit the size class list search keeps the best fit among
+ * the blocks it looks at, and if none fits it takes the head of a
+ * larger class or grows the heap rather than look further. TLSF,
+ * the tree and the size array are bounded already and ignore it.
  */
-void *mm_realloc(void *ptr, size_t size)
+int mm_probe_limit(int n)
 {
-	/**
-	 * 1. if ptr is NULL, the call is equivalent to mm malloc(size);
-	 * 2. if size is equal to zero, the call is equivalent to mm free(ptr);
-	 * 3. if ptr is not NULL, it must have been returned by an earlier call to mm malloc or mm realloc.
-	 * 
-	 * The call to mm realloc changes the size of the memory block pointed to by ptr (the old block)
-	 * to size bytes and returns the address of the new block. Notice that the address of the 
-	 * new block might be the same as the old block, or it might be different, depending on your
-	 * implementation, the amount of internal fragmentation in the old block, and the size of the
-	 * realloc request. The contents of the new block are the same as those of the old ptr block, up
-	 * to the minimum of the old and new sizes. Everything else is uninitialized.
-	 * 
-	 * For example, if the old block is 8 bytes and the new block is 12 bytes, then the first 8 bytes
-	 * of the new block are identical to the first 8 bytes of the old block and the last 4 bytes are
-	 * uninitialized.
-	 * 
-	 * Similarly, if the old block is 8 bytes and the new block is 4 bytes, then the
-	 * contents of the new block are identical to the first 4 bytes of the old block.
-	 */
+	int old = probe_limit;
 
-	if(ptr == NULL && size > 0){
-		return mm_malloc(size);
-	} else if(ptr != NULL && size == 0) {
-		mm_free(ptr);
-		return NULL;
-	} else if(ptr != NULL && size > 0) {
-		size_t oldSize = GET_SIZE(HDRP(ptr));
+	if (n >= 0) {
+		probe_limit = n;
+	}
+	return old;
+}
 
-		/* Adjust block size to include overhead and alignment reqs. */
-		if (size <= DSIZE) {
-			size = MINSIZE;
-		}
-		else {
-			size = DSIZE * ((size + OVERHEAD + DSIZE - 1) / DSIZE);
-		}
+/*
+ * mm_grow_policy - Sets the heap growth policy of arena id, or of
+ *         every arena if id is negative: steps start at min bytes,
+ *         double while extensions come less than window mallocs and
+ *         frees apart, and stay within 1/2^max_shift of the heap. It
+ *         holds across mm_init() calls. Returns -1 if id or the
+ *         policy is out of range, else 0.
+ */
+int mm_grow_policy(int id, size_t min, int max_shift, unsigned int window)
+{
+	if (id >= MAX_ARENAS || min == 0 || min > MAX_HEAP || max_shift < 0 || max_shift > 31) {
+		return -1;
+	}
+	pthread_once(&arenas_once, arenas_setup);
+	min = (min + ALIGNSIZE - 1) / ALIGNSIZE * ALIGNSIZE;
+	for (int i = (id < 0) ? 0 : id; i < ((id < 0) ? MAX_ARENAS : id + 1); i++) {
+		grow_t *g = &arenas[i].heap_grow;
+		pthread_mutex_lock(&arenas[i].lock);
+		g->min = min;
+		g->max_shift = max_shift;
+		g->window = window;
+		g->step = MAX(g->step, min);
+		pthread_mutex_unlock(&arenas[i].lock);
+	}
+	return 0;
+}
 
-		// if sizes are the same or the difference is less than a MINSIZE, no changes needed
-		if(oldSize == size || (oldSize - size < MINSIZE)) {
-			return ptr;
-		} else {
-			
-			// If size is less than old size, shrink and free end
-			if(size < oldSize) {
-				PUT(HDRP(ptr), PACK(size, 0));
-				PUT(FTRP(ptr), PACK(size, 0));
-				PUT(HDRP(NEXT_BLKP(ptr)), PACK(oldSize-size, 1));
-				PUT(FTRP(NEXT_BLKP(ptr)), PACK(oldSize-size, 1));
-				add_to_list(NEXT_BLKP(ptr));
-				return ptr;
-			}
-			
-			// If size is greater than old size, grow and free end
-			else if(size > oldSize) {
-				size_t nextSize = GET_SIZE(HDRP(NEXT_BLKP(ptr))) + oldSize;
-				if(GET_ALLOC(HDRP(NEXT_BLKP(ptr))) && nextSize >= size){
-					if ((nextSize - size) >= MINSIZE) {
-						remove_from_list(NEXT_BLKP(ptr));
-						PUT(HDRP(ptr), PACK(size, 0));
-						PUT(FTRP(ptr), PACK(size, 0));
-						PUT(HDRP(NEXT_BLKP(ptr)), PACK(nextSize-size, 1));
-						PUT(FTRP(NEXT_BLKP(ptr)), PACK(nextSize-size, 1));
-						add_to_list(NEXT_BLKP(ptr));
-					}
-					else { 
-						remove_from_list(NEXT_BLKP(ptr));
-						PUT(HDRP(ptr), PACK(nextSize, 0));
-						PUT(FTRP(ptr), PACK(nextSize, 0));
-					}
-					
-					return ptr;
-				}
-				// else malloc
-				void * newPtr;
-				if((newPtr = mm_malloc(size)) == NULL){
-					return NULL;
-				}
-				// copy memory
-				mm_memcpy(newPtr, ptr);
-				// free
-				mm_free(ptr);
-				return newPtr;
+/*
+ * mm_fit_use - Selects the placement policy of the size class lists
+ *         by name, returns -1 if there is no such policy or the free
+ *         block index has a placement of its own. The policies are
+ *
+ *   first    first block that fits in the list searched
+ *   next     first fit, starting where the last search stopped
+ *   best     smallest block that fits
+ *   good     first block at most 1/2^GOOD_FIT_SHIFT larger, else best
+ *   address  first fit with the lists kept in address order
+ *
+ * Switching to or from "address" is safe at any time, but the lists
+ * are only fully in address order after the next mm_init().
+ */
+int mm_fit_use(const char *name)
+{
+#if !USE_TLSF && !USE_TREE && !USE_SCAN
+	for (int i = 0; i < NUM_FITS; i++) {
+		if (strcmp(name, fit_names[i]) == 0) {
+			fit_policy = i;
+			for (int j = 0; j < MAX_ARENAS; j++) {
+				arenas[j].rover = NULL;
 			}
-
+			return 0;
 		}
 	}
-
-	return NULL;
+#endif
+	return -1;
 }
 
-/**
- * mm_memcpy - copies memory to destination from source
- * 
- * Memory is coppied block by block and truncated if
- * destination is smaller than source
- */ 
+/*
+ * mm_fit_name - Returns the name of the placement policy in use
+ */
+const char *mm_fit_name(void)
+{
+#if USE_TLSF
+	return "tlsf";
+#elif USE_TREE
+	return "tree";
+#elif USE_SCAN
+	return "scan";
+#else
+	return fit_names[fit_policy];
+#endif
+}
 
-void mm_memcpy(void * dest, void * src)
+/*
+ * mm_split_use - Selects where a block of up to SPLIT_SMALL bytes is
+ *         cut from the free block it is placed in, "front" or "back".
+ *         Returns -1 for any other name.
+ */
+int mm_split_use(const char *name)
 {
-	for(size_t i = 0; i < GET_SIZE(HDRP(dest))-OVERHEAD; i++){
-		((char *) dest)[i] = ((char *) src)[i];
+	if (strcmp(name, "front") == 0 || strcmp(name, "back") == 0) {
+		split_back = (name[0] == 'b');
+		return 0;
 	}
+	return -1;
 }
 
-/* 
- * mm_checkheap - Check the heap for consistency 
+/*
+ * mm_split_name - Returns where small blocks are cut from
  */
-void mm_checkheap(int verbose) 
+const char *mm_split_name(void)
 {
-	printf("\n");
-
-	char *bp = heap_listp;
+	return split_back ? "back" : "front";
+}
 
-	if (verbose){
-		printf("Heap (%p):\n", heap_listp);
+/*
+ * mm_get_counters - Stores the event counters of all arenas set up
+ *         since mm_init() in c, summed. headroom_shift is the one of
+ *         the first arena.
+ */
+void mm_get_counters(mm_counters_t *c)
+{
+	memset(c, 0, sizeof(*c));
+	for (int i = 0; i < MAX_ARENAS; i++) {
+		arena_t *a = &arenas[i];
+		pthread_mutex_lock(&a->lock);
+		if (a->gen == mm_gen) {
+			c->reallocs += a->counters.reallocs;
+			c->realloc_inplace += a->counters.realloc_inplace;
+			c->realloc_forward += a->counters.realloc_forward;
+			c->realloc_backward += a->counters.realloc_backward;
+			c->realloc_extend += a->counters.realloc_extend;
+			c->headroom_grants += a->counters.headroom_grants;
+			c->headroom_hits += a->counters.headroom_hits;
+			c->headroom_bytes += a->counters.headroom_bytes;
+			c->calloc_bytes += a->counters.calloc_bytes;
+			c->calloc_zeroed += a->counters.calloc_zeroed;
+			c->batch_runs += a->counters.batch_runs;
+			c->batch_merged += a->counters.batch_merged;
+			c->mapped_blocks += a->counters.mapped_blocks;
+			c->map_moves += a->counters.map_moves;
+			c->trims += a->counters.trims;
+			c->trimmed_bytes += a->counters.trimmed_bytes;
+			c->purges += a->counters.purges;
+			c->purged_bytes += a->counters.purged_bytes;
+			c->sbrks += a->counters.sbrks;
+			c->sbrk_bytes += a->counters.sbrk_bytes;
+			c->fast_mallocs += a->counters.fast_mallocs;
+			c->fast_hits += a->counters.fast_hits;
+			c->fast_consolidations += a->counters.fast_consolidations;
+			c->fit_probes += a->counters.fit_probes;
+			c->fit_cutoffs += a->counters.fit_cutoffs;
+		}
+		pthread_mutex_unlock(&a->lock);
 	}
+	c->headroom_shift = arenas[0].counters.headroom_shift;
+}
 
-	// Check if prologue header is good
-	if ((GET_SIZE(HDRP(heap_listp)) != DSIZE) || GET_ALLOC(HDRP(heap_listp))){
-		printf("Bad prologue header\n");
-	}
-	
-	// check if every block in free list is actaully free
-	char * node = free_listp;
-	int freeCount = 0;
+/*********************************************************
+ * Entry points
+ *
+ * Each locks the arena it works on for the whole call: the
+ * calling thread's arena to allocate, the arena a block came
+ * from to free or resize it. The work itself is done by the
+ * arena_* function of the same name on the current arena.
+ * mm_malloc() and mm_free() try the thread cache first.
+ *********************************************************/
 
-	do
-	{
-		if(node == NULL){
-			break;
-		}
-		if(!GET_ALLOC(HDRP(node))){
-			printf("%p not free but is in list!\n", node);
-		}
-		freeCount++;
-		node = GET_NEXT_FREE(node);
-	} while (node != free_listp);
-	
+/* 
+ * mm_malloc - Allocate a block with at least size bytes of payload 
+ */
+void *mm_malloc(size_t size)
+{
+	void *bp;
 
-	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-		//if free, see if it can be found in the free list
-		if(GET_ALLOC(HDRP(bp))){
-			node = free_listp;
-			do
-			{	
-				if(node == bp){
-					break;
-				}else{
-					node = GET_NEXT_FREE(node);
-				}
-			} while (node != free_listp);
-			if(node != bp){
-				printf("%p is free but not in list!\n", bp);
-			}
-		}
-		if (verbose){
-			printblock(bp);
-		}
-	}
+#if TCACHE_MAX
+	size_t bsize;
 
-	if (verbose){
-		printblock(bp);
+	if (size > 0 && size <= TCACHE_MAX && (bsize = tcache_size(size)) <= TCACHE_MAX &&
+		(bp = tcache_get(bsize)) != NULL) {
+		return bp;
 	}
-	if ((GET_SIZE(HDRP(bp)) != 0) || (GET_ALLOC(HDRP(bp)))){
-		printf("Bad epilogue header\n");
+#endif
+	if (arena_enter(NULL) == NULL) {
+		return NULL;
 	}
+	bp = arena_malloc(size);
+	arena_leave();
+	return bp;
 }
 
-/**
- * add_to_list - Adds free block to list and coalesces
- * 
- * Will try to add block in address order, or combine
+/*
+ * mm_memalign - Allocate a block with at least size bytes of payload
+ *         aligned to align, a power of two
  */
-static void add_to_list(void* bp){
+void *mm_memalign(size_t align, size_t size)
+{
+	void *bp;
+
+	if (arena_enter(NULL) == NULL) {
+		return NULL;
+	}
+	bp = arena_memalign(align, size);
+	arena_leave();
+	return bp;
+}
+
+/*
+ * mm_calloc - Allocate a zeroed array of nmemb elements of size bytes
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+	void *bp;
+
+	if (arena_enter(NULL) == NULL) {
+		return NULL;
+	}
+	bp = arena_calloc(nmemb, size);
+	arena_leave();
+	return bp;
+}
+
+/*
+ * mm_malloc_batch - Allocate n blocks with at least size bytes of
+ *         payload each, storing them in out. Returns how many were
+ *         allocated, n unless memory ran out.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+	size_t done;
+
+	if (arena_enter(NULL) == NULL) {
+		return 0;
+	}
+	done = arena_malloc_batch(size, n, out);
+	arena_leave();
+	return done;
+}
+
+/* 
+ * mm_free - Free a block 
+ */
+void mm_free(void *bp)
+{
+#if TCACHE_MAX
+	if (bp != NULL && tcache_put(bp, tcache_block_size(bp))) {
+		return;
+	}
+#endif
+	if (arena_enter(arena_of(bp)) == NULL) {
+		return;
+	}
+	arena_free(bp);
+	arena_leave();
+}
+
+/*
+ * mm_free_sized - Free a block given the size it was allocated with,
+ *         or last resized to by mm_realloc()
+ */
+void mm_free_sized(void *bp, size_t size)
+{
+#if TCACHE_MAX && !MM_DEBUG
+	if (bp != NULL && tcache_put(bp, tcache_sized_size(bp, size))) {
+		return;
+	}
+#endif
+	if (arena_enter(arena_of(bp)) == NULL) {
+		return;
+	}
+	arena_free_sized(bp, size);
+	arena_leave();
+}
+
+/*
+ * mm_free_batch - Free the n blocks in ptrs, which is reordered in
+ *         the process. NULL entries are skipped.
+ *
+ * Sorted by address, the blocks of each arena are next to each other,
+ * so every arena is locked once for all of its blocks.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+	size_t i, j;
+
+	qsort(ptrs, n, sizeof(void *), ptr_cmp);
+	for (i = 0; i < n; i = j) {
+		arena_t *a = arena_of(ptrs[i]);
+		for (j = i + 1; j < n && arena_of(ptrs[j]) == a; j++)
+			;
+		if (arena_enter(a) != NULL) {
+			arena_free_batch(ptrs + i, j - i);
+			arena_leave();
+		}
+	}
+}
+
+/*
+ * mm_realloc - Resize an allocated block, in the arena it came from
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+	void *bp;
+
+	if (arena_enter(arena_of(ptr)) == NULL) {
+		return NULL;
+	}
+	bp = arena_realloc(ptr, size);
+	arena_leave();
+	return bp;
+}
+
+/* 
+ * mm_checkheap - Check the heap of every arena in use for consistency 
+ */
+void mm_checkheap(int verbose) 
+{
+	for (int i = 0; i < MAX_ARENAS; i++) {
+		if (arenas[i].gen == mm_gen && arena_enter(&arenas[i]) != NULL) {
+			check_arena(verbose);
+			arena_leave();
+		}
+	}
+}
+
+#if TCACHE_MAX
+/*********************************************************
+ * Thread caches
+ *
+ * A thread keeps the blocks of up to TCACHE_MAX bytes it
+ * frees in a stack per block size, still allocated as far as
+ * their arenas know, and its mallocs of that size pop them
+ * back without a lock or an atomic operation. An empty stack
+ * is refilled with TCACHE_BATCH blocks by mm_malloc_batch(),
+ * and a full one, or a cache holding TCACHE_BYTES, sends its
+ * oldest TCACHE_BATCH blocks back by mm_free_batch(), so each
+ * lock round trip is shared by a batch of blocks. A block may
+ * go back to another arena than the one of the thread that
+ * cached it. The cache is flushed when its thread exits, and
+ * dropped by mm_init() along with the heaps.
+ *
+ * Slab objects and heap blocks share the stacks, by size.
+ * Heap blocks of sizes slabs serve only come from
+ * mm_memalign() and are not cached, so a stack never mixes
+ * a slab object with a heap block one header word smaller.
+ *********************************************************/
+
+/*
+ * tcache_size - Returns the size of the block mm_malloc() places
+ *         size bytes in, a slab object or a heap block
+ */
+static size_t tcache_size(size_t size)
+{
+#if USE_SLAB
+	if (size <= SLAB_MAX) {
+		return slab_sizes[slab_class(size)] * ALIGNSIZE;
+	}
+#endif
+	return adjust_size(size);
+}
+
+/*
+ * tcache_block_size - Returns the size of allocated block bp, or 0
+ *         if it is not to be cached
+ *
+ * No lock is held. The slab map entry of the page of bp and the size
+ * in its header stay put while bp is allocated, only the pf bit of
+ * the header may be changed by the arena meanwhile. The arena does
+ * that with SET_PFREE() and CLR_PFREE(), atomic stores like the
+ * atomic load here, so the two never race.
+ */
+static size_t tcache_block_size(void *bp)
+{
+	unsigned int hdr;
+
+	if (IS_MAPPED(bp)) {
+		return 0;
+	}
+#if USE_SLAB
+	arena_t *a = ARENA_OF(bp);
+	if (a->slab_map[(uintptr_t)bp / SLAB_SIZE - (uintptr_t)a->heap_lo / SLAB_SIZE]) {
+		return SLAB_OF(bp)->size;
+	}
+#endif
+	// free blocks are left to mm_free() to report, grown ones to lose their grown bit
+	hdr = __atomic_load_n((unsigned int *)HDRP(bp), __ATOMIC_RELAXED);
+	if (hdr & (FREE_BIT | GROWN_BIT)) {
+		return 0;
+	}
+#if USE_SLAB
+	if ((hdr & ~0x7) <= SLAB_MAX) {
+		return 0;
+	}
+#endif
+	return hdr & ~0x7;
+}
+
+#if !MM_DEBUG
+/*
+ * tcache_sized_size - Returns the size of the stack for block bp
+ *         freed with size bytes, or 0 if it is not to be cached
+ *
+ * No lock is held and the header of bp is not read. Slab objects
+ * go by the size in their slab, heap blocks by the size mm_malloc()
+ * gives size bytes, which the block holds at least.
+ */
+static size_t tcache_sized_size(void *bp, size_t size)
+{
+	if (IS_MAPPED(bp)) {
+		return 0;
+	}
+#if USE_SLAB
+	if (size <= SLAB_MAX) {
+		arena_t *a = ARENA_OF(bp);
+		// heap blocks this small, from mm_memalign() or shrunk by mm_realloc(), are not cached
+		if (a->slab_map[(uintptr_t)bp / SLAB_SIZE - (uintptr_t)a->heap_lo / SLAB_SIZE]) {
+			return SLAB_OF(bp)->size;
+		}
+		return 0;
+	}
+#endif
+	return adjust_size(size);
+}
+#endif
+
+/*
+ * tcache_reset - Empties cache tc without freeing its blocks, as
+ *         mm_init() has done away with them
+ */
+static void tcache_reset(tcache_t *tc)
+{
+	memset(tc->count, 0, sizeof(tc->count));
+	tc->bytes = 0;
+	tc->gen = mm_gen;
+	pthread_setspecific(tcache_key, tc);
+}
+
+/*
+ * tcache_get - Pops a block of bsize bytes from the calling
+ *         thread's cache, refilling its stack from the thread's
+ *         arena if empty. Returns NULL if there is no room to.
+ */
+static void *tcache_get(size_t bsize)
+{
+	tcache_t *tc = &tcache;
+	int bin = bsize / ALIGNSIZE;
+
+	if (tc->gen != mm_gen) {
+		tcache_reset(tc);
+	}
+	if (tc->count[bin] == 0) {
+		size_t n = MIN(TCACHE_BATCH, (TCACHE_BYTES - tc->bytes) / bsize);
+		// the payload a block of bsize bytes is placed for
+		size_t size = (USE_SLAB && bsize <= SLAB_MAX) ? bsize : bsize - OVERHEAD;
+
+		if (n == 0) {
+			return NULL;
+		}
+		tc->count[bin] = mm_malloc_batch(size, n, tc->bins[bin]);
+		tc->bytes += tc->count[bin] * bsize;
+		if (tc->count[bin] == 0) {
+			return NULL;
+		}
+	}
+	tc->bytes -= bsize;
+	return tc->bins[bin][--tc->count[bin]];
+}
+
+/*
+ * tcache_put - Pushes allocated block bp on the stack for blocks of
+ *         bsize bytes of the calling thread's cache, sending the
+ *         oldest blocks of the stack back first if that is full.
+ *         Returns 0 if bp is not cached, as when bsize is 0.
+ */
+static int tcache_put(void *bp, size_t bsize)
+{
+	tcache_t *tc = &tcache;
+	int bin = bsize / ALIGNSIZE;
+
+	if (bsize == 0 || bsize > TCACHE_MAX) {
+		return 0;
+	}
+	if (tc->gen != mm_gen) {
+		tcache_reset(tc);
+	}
+	if (tc->count[bin] == TCACHE_COUNT || tc->bytes + bsize > TCACHE_BYTES) {
+		tcache_flush(tc, bin, TCACHE_BATCH);
+		// the bytes may be held by other stacks
+		if (tc->bytes + bsize > TCACHE_BYTES) {
+			return 0;
+		}
+	}
+	tc->bins[bin][tc->count[bin]++] = bp;
+	tc->bytes += bsize;
+	return 1;
+}
+
+/*
+ * tcache_flush - Frees the oldest n blocks, or all if fewer, of
+ *         stack bin of cache tc
+ */
+static void tcache_flush(tcache_t *tc, int bin, int n)
+{
+	void *batch[TCACHE_COUNT];
+
+	n = MIN(n, tc->count[bin]);
+	memcpy(batch, tc->bins[bin], n * sizeof(void *));
+	memmove(tc->bins[bin], tc->bins[bin] + n, (tc->count[bin] - n) * sizeof(void *));
+	tc->count[bin] -= n;
+	tc->bytes -= (size_t)n * bin * ALIGNSIZE;
+	mm_free_batch(batch, n);
+}
+
+/*
+ * tcache_exit - Frees every block in the cache p of an exiting thread
+ */
+static void tcache_exit(void *p)
+{
+	tcache_t *tc = p;
+
+	if (tc->gen != mm_gen) {
+		return;
+	}
+	for (int bin = 0; bin < TCACHE_BINS; bin++) {
+		tcache_flush(tc, bin, TCACHE_COUNT);
+	}
+}
+#endif
+
+/* 
+ * arena_malloc - Allocate a block with at least size bytes of payload 
+ */
+/* $begin mmmalloc */
+static void *arena_malloc(size_t size)
+{
+	size_t asize;      /* adjusted block size */
+	char *bp;
+
+	/* Ignore spurious requests */
+	if (size <= 0){
+		return NULL;
+	}
+	op_tick();
+
+#if USE_SLAB
+	/* Small requests are served from slabs */
+	if (size <= SLAB_MAX){
+		return slab_malloc(size);
+	}
+#endif
+
+	/* Huge requests get their own mapping */
+	if (size >= MMAP_THRESHOLD){
+		return map_malloc(size);
+	}
+
+	/* Adjust block size to include overhead and alignment reqs. */
+	asize = adjust_size(size);
+
+#if FAST_MAX
+	/* Reuse a block of this size freed since the bins were coalesced */
+	if (asize <= FAST_MAX && (bp = fast_pop(asize)) != NULL) {
+		return bp;
+	}
+#endif
+
+	/* Search the free lists for a fit, else use the wilderness */
+	if ((bp = find_fit(asize)) == NULL && (bp = wild_fit(asize)) == NULL) {
+		printf("mm_malloc = NULL\n");
+		return NULL;
+	}
+
+	bp = place_split(bp, asize);
+
+	//mm_checkheap(0);
+
+	return bp;
+} 
+/* $end mmmalloc */
+
+/*
+ * arena_memalign - Allocate a block with at least size bytes of payload
+ *         aligned to align, a power of two
+ *
+ * The block goes at the first aligned spot in a free block. The slack
+ * in front of it is split off as a free block, and whatever is left
+ * after it is split off as place() does for any block.
+ */
+static void *arena_memalign(size_t align, size_t size)
+{
+	if (size == 0){
+		return NULL;
+	}
+	if (align == 0 || (align & (align - 1)) != 0) {
+		fprintf(stderr, "mm_memalign(): alignment %zu is not a power of two\n", align);
+		return NULL;
+	}
+
+	// every payload is ALIGNSIZE aligned already
+	if (align <= ALIGNSIZE) {
+		return arena_malloc(size);
+	}
+	return malloc_aligned(adjust_size(size), align);
+}
+
+/*
+ * mm_aligned_alloc - C11 aligned_alloc(), size need not be a multiple
+ *         of align here
+ */
+void *mm_aligned_alloc(size_t align, size_t size)
+{
+	return mm_memalign(align, size);
+}
+
+/*
+ * arena_calloc - Allocate a zeroed array of nmemb elements of size bytes
+ *
+ * Only the part of the block below zero_lo, and the words it used
+ * as free block tags and links, need to be cleared.
+ */
+static void *arena_calloc(size_t nmemb, size_t size)
+{
+	size_t bytes = nmemb * size;
+	char *zp = arena->zero_lo;		/* zero_lo before the block is placed */
+	char *bp;
+
+	if (nmemb != 0 && bytes / nmemb != size) {
+		fprintf(stderr, "mm_calloc(): %zu * %zu bytes overflows\n", nmemb, size);
+		return NULL;
+	}
+	if ((bp = arena_malloc(bytes)) == NULL) {
+		return NULL;
+	}
+	arena->counters.calloc_bytes += bytes;
+
+	// a new mapping is zero already
+	if (IS_MAPPED(bp)) {
+		return bp;
+	}
+
+#if USE_SLAB
+	if (IS_SLAB(bp)) {
+		memset(bp, 0, bytes);
+		arena->counters.calloc_zeroed += bytes;
+		return bp;
+	}
+#endif
+
+	char *end = bp + bytes;
+	char *dirty = MIN(MAX(zp, bp + 2*WSIZE), end);	/* links are always dirty */
+	memset(bp, 0, dirty - bp);
+	arena->counters.calloc_zeroed += dirty - bp;
+
+	// the footer, if the whole free block was taken
+	if (FTRP(bp) >= dirty && FTRP(bp) < end) {
+		memset(FTRP(bp), 0, end - FTRP(bp));
+		arena->counters.calloc_zeroed += end - FTRP(bp);
+	}
+	return bp;
+}
+
+/*
+ * arena_malloc_batch - Allocate n blocks with at least size bytes of
+ *         payload each, storing them in out. Returns how many were
+ *         allocated, n unless memory ran out.
+ *
+ * The size is adjusted once, and every free block find_fit() returns
+ * is cut into as many of the blocks as it holds in a single pass,
+ * so a run costs one search per free block rather than per block.
+ */
+static size_t arena_malloc_batch(size_t size, size_t n, void **out)
+{
+	size_t asize, i, k;
+	char *bp;
+
+	if (size == 0){
+		return 0;
+	}
+	op_tick();
+
+#if USE_SLAB
+	if (size <= SLAB_MAX){
+		for (i = 0; i < n && (out[i] = slab_malloc(size)) != NULL; i++)
+			;
+		return i;
+	}
+#endif
+
+	if (size >= MMAP_THRESHOLD){
+		for (i = 0; i < n && (out[i] = map_malloc(size)) != NULL; i++)
+			;
+		return i;
+	}
+
+	asize = adjust_size(size);
+	if (n > MAX_HEAP / asize) {
+		fprintf(stderr, "mm_malloc_batch(): %zu * %zu bytes is more than the heap\n", n, size);
+		return 0;
+	}
+
+	for (i = 0; i < n; i += k) {
+		// the wilderness takes what is left of the run, as mm_malloc() would one block
+		if ((bp = find_fit(asize)) == NULL && (bp = wild_fit(asize * (n-i))) == NULL) {
+			return i;
+		}
+		k = MIN(n - i, GET_SIZE(HDRP(bp)) / asize);
+		place_batch(bp, asize, k, out + i);
+		arena->counters.batch_runs++;
+	}
+	return n;
+}
+
+/* 
+ * arena_free - Free a block 
+ * 
+ * Given the alloced bit is set, marks the block free and
+ * coalesces it with its neighbours, else print error to stderr.
+ */
+/* $begin mmfree */
+static void arena_free(void *bp)
+{
+	if(bp == NULL){
+		fprintf(stderr, "mm_free(): null pointer");
+		return;
+	}
+	op_tick();
+
+	if(IS_MAPPED(bp)){
+		map_free(bp);
+		return;
+	}
+
+#if USE_SLAB
+	if(IS_SLAB(bp)){
+		slab_free(bp);
+		return;
+	}
+#endif
+
+	// If allocated, free
+	if(!GET_FREE(HDRP(bp))){
+#if FAST_MAX
+		if(GET_SIZE(HDRP(bp)) <= FAST_MAX){
+			fast_push(bp);
+			return;
+		}
+#endif
+		free_block(bp);
+	} else {
+		fprintf(stderr, "mm_free(): memory not alloced or corrupted");
+		return;
+	}
+		
+}
+
+/* $end mmfree */
+
+/*
+ * arena_free_sized - Free a block given the size it was allocated with,
+ *         or last resized to by mm_realloc()
+ *
+ * Blocks of more than SLAB_MAX bytes are never slab objects, so they
+ * skip the slab map lookup, and the fast bin or free list is picked
+ * from the size mm_malloc() gives size bytes rather than the header.
+ * Unless MM_DEBUG is set the check that the block is allocated is
+ * skipped too. Marking the block free still rewrites its header,
+ * as placement and realloc headroom can leave it larger than that.
+ */
+static void arena_free_sized(void *bp, size_t size)
+{
+#if MM_DEBUG
+	if (bp != NULL && !check_sized(bp, size)) {
+		fprintf(stderr, "mm_free_sized(): block %p does not hold %zu bytes\n", bp, size);
+		return;
+	}
+#endif
+	// only blocks of up to SLAB_MAX bytes may be slab objects
+	if (bp == NULL || (USE_SLAB && size <= SLAB_MAX) || IS_MAPPED(bp)) {
+		arena_free(bp);
+		return;
+	}
+
+	op_tick();
+#if FAST_MAX
+	if (adjust_size(size) <= FAST_MAX) {
+		fast_push(bp);
+		return;
+	}
+#endif
+	free_block(bp);
+}
+
+/*
+ * arena_free_batch - Free the n blocks in ptrs, sorted by address,
+ *         which is reordered in the process. NULL entries are skipped.
+ *
+ * Slab objects and mapped blocks are freed as they come. Of the
+ * others, blocks that sit next to each other are marked free
+ * as one block, so a run of them costs one coalesce() and one free
+ * list insert.
+ */
+static void arena_free_batch(void **ptrs, size_t n)
+{
+	size_t i, j, m = 0;
+
+	op_tick();
+	// move the heap blocks to the front, keeping their order
+	for (i = 0; i < n; i++) {
+		if (ptrs[i] == NULL) {
+			continue;
+		}
+		if (IS_MAPPED(ptrs[i])) {
+			map_free(ptrs[i]);
+			continue;
+		}
+#if USE_SLAB
+		if (IS_SLAB(ptrs[i])) {
+			slab_free(ptrs[i]);
+			continue;
+		}
+#endif
+		ptrs[m++] = ptrs[i];
+	}
+
+	for (i = 0; i < m; i = j) {
+		char *bp = ptrs[i];
+		j = i + 1;
+
+		if (GET_FREE(HDRP(bp))) {
+			arena_free(bp);		/* reports the error */
+			continue;
+		}
+
+		// take in the allocated blocks right after bp
+		size_t size = GET_SIZE(HDRP(bp));
+		while (j < m && (char *)ptrs[j] == bp + size && !GET_FREE(HDRP(ptrs[j]))) {
+			size += GET_SIZE(HDRP(ptrs[j]));
+			j++;
+		}
+		arena->counters.batch_merged += j - i - 1;
+		PUT(HDRP(bp), PACK(size, FREE_BIT | GET_PFREE(HDRP(bp))));
+		PUT(FTRP(bp), PACK(size, FREE_BIT));
+		coalesce(bp);
+	}
+	trim_heap();
+}
+
+#if MM_DEBUG
+/*
+ * check_sized - Returns true if allocated block bp can hold size
+ *         bytes, the check mm_free_sized() makes with MM_DEBUG
+ */
+static int check_sized(void *bp, size_t size)
+{
+	if (IS_MAPPED(bp)) {
+		return size + ALIGNSIZE <= GET_SIZE(HDRP(bp));
+	}
+#if USE_SLAB
+	if (IS_SLAB(bp)) {
+		return size <= SLAB_OF(bp)->size;
+	}
+#endif
+	return !GET_FREE(HDRP(bp)) && adjust_size(size) <= GET_SIZE(HDRP(bp));
+}
+#endif
+
+/*
+ * ptr_cmp - qsort() comparison of two pointers by address
+ */
+static int ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t x = (uintptr_t)*(void * const *)a;
+	uintptr_t y = (uintptr_t)*(void * const *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * arena_realloc - Resize an allocated block
+ * 
+ * Shrinks in place, and grows in place when realloc_grow() can
+ * find the room around the block. Otherwise mallocs a new block,
+ * copies the payload over and frees the old one.
+ * 
+ */
+static void *arena_realloc(void *ptr, size_t size)
+{
+	/**
+	 * 1. if ptr is NULL, the call is equivalent to mm malloc(size);
+	 * 2. if size is equal to zero, the call is equivalent to mm free(ptr);
+	 * 3. if ptr is not NULL, it must have been returned by an earlier call to mm malloc or mm realloc.
+	 * 
+	 * The call to mm realloc changes the size of the memory block pointed to by ptr (the old block)
+	 * to size bytes and returns the address of the new block. Notice that the address of the 
+	 * new block might be the same as the old block, or it might be different, depending on your
+	 * implementation, the amount of internal fragmentation in the old block, and the size of the
+	 * realloc request. The contents of the new block are the same as those of the old ptr block, up
+	 * to the minimum of the old and new sizes. Everything else is uninitialized.
+	 * 
+	 * For example, if the old block is 8 bytes and the new block is 12 bytes, then the first 8 bytes
+	 * of the new block are identical to the first 8 bytes of the old block and the last 4 bytes are
+	 * uninitialized.
+	 * 
+	 * Similarly, if the old block is 8 bytes and the new block is 4 bytes, then the
+	 * contents of the new block are identical to the first 4 bytes of the old block.
+	 */
+
+	if(ptr == NULL && size > 0){
+		return arena_malloc(size);
+	} else if(ptr != NULL && size == 0) {
+		arena_free(ptr);
+		return NULL;
+	} else if(ptr != NULL && size > 0) {
+		arena->counters.reallocs++;
+		op_tick();
+		if(IS_MAPPED(ptr)){
+			return map_realloc(ptr, size);
+		}
+#if USE_SLAB
+		// slab objects stay put while the request fits the object
+		if(IS_SLAB(ptr)){
+			size_t objSize = SLAB_OF(ptr)->size;
+			if(size <= objSize){
+				arena->counters.realloc_inplace++;
+				return ptr;
+			}
+			void * newPtr;
+			if((newPtr = arena_malloc(size)) == NULL){
+				return NULL;
+			}
+			mm_memcpy(newPtr, ptr, objSize);
+			slab_free(ptr);
+			return newPtr;
+		}
+#endif
+		size_t oldSize = GET_SIZE(HDRP(ptr));
+		size_t asize = adjust_size(size);
+		size_t room = asize;	/* asize plus any headroom */
+		void * newPtr;
+
+#if USE_HEADROOM
+		// blocks that were grown before are likely to grow again
+		if(GET_GROWN(HDRP(ptr))) {
+			room += (asize >> arena->headroom_shift) & ~(size_t)(ALIGNSIZE-1);
+		}
+#endif
+
+		// shrinking, or growing within the block, never moves it
+		if(asize <= oldSize) {
+			realloc_trim(ptr, MIN(room, oldSize));
+#if USE_HEADROOM
+			if(room > asize) {
+				arena->counters.headroom_hits++;
+				arena->window_hits++;
+			}
+#endif
+			arena->counters.realloc_inplace++;
+			return ptr;
+		}
+
+		// try to grow without relocating, with headroom if possible
+		if((newPtr = realloc_grow(ptr, room)) == NULL && room > asize) {
+			newPtr = realloc_grow(ptr, asize);
+		}
+		if(newPtr != NULL) {
+			arena->counters.realloc_inplace++;
+		} else {
+			// else malloc
+			if((newPtr = arena_malloc(room - OVERHEAD)) == NULL){
+				return NULL;
+			}
+			// copy memory
+			mm_memcpy(newPtr, ptr, MIN(oldSize - OVERHEAD, size));
+			// free
+			arena_free(ptr);
+#if USE_SLAB
+			// a small block may have moved to a slab, with no header to mark
+			if(room - OVERHEAD <= SLAB_MAX){
+				return newPtr;
+			}
+#endif
+		}
+			
+#if USE_HEADROOM
+		if(GET_SIZE(HDRP(newPtr)) >= room && room > asize) {
+			arena->counters.headroom_grants++;
+			arena->counters.headroom_bytes += room - asize;
+			headroom_adapt();
+		}
+		arena->counters.headroom_shift = arena->headroom_shift;
+#endif
+		SET_GROWN(HDRP(newPtr));
+		return newPtr;
+	}
+
+	return NULL;
+}
+
+/*
+ * realloc_trim - Shrink allocated block bp to asize bytes, the tail
+ *         is split off as a free block if it is big enough for one
+ */
+static void realloc_trim(void *bp, size_t asize)
+{
+	size_t csize = GET_SIZE(HDRP(bp));
+
+	if ((csize - asize) >= MINSIZE) {
+		PUT(HDRP(bp), PACK(asize, GET_PFREE(HDRP(bp)) | GET_GROWN(HDRP(bp))));
+		bp = NEXT_BLKP(bp);
+		PUT(HDRP(bp), PACK(csize-asize, FREE_BIT));
+		PUT(FTRP(bp), PACK(csize-asize, FREE_BIT));
+		coalesce(bp);
+		trim_heap();
+	}
+}
+
+/*
+ * realloc_grow - Grow allocated block bp to asize bytes without a new
+ *         allocation. In order it tries absorbing the next block if
+ *         free, absorbing the previous block if free and moving the
+ *         payload down, and extending the heap if bp is the last
+ *         block. Returns the grown block, or NULL if none applies.
+ */
+static void *realloc_grow(void *bp, size_t asize)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+	char *next = NEXT_BLKP(bp);
+	size_t nsize = GET_FREE(HDRP(next)) ? GET_SIZE(HDRP(next)) : 0;
+
+	if (size + nsize < asize) {
+		// absorb the previous block, and the next if free
+		if (GET_PFREE(HDRP(bp))) {
+			char *prev = PREV_BLKP(bp);
+			size_t total = GET_SIZE(HDRP(prev)) + size + nsize;
+			if (total >= asize) {
+				remove_free(prev);
+				if (nsize) {
+					remove_free(next);
+				}
+				PUT(HDRP(prev), PACK(total, GET_PFREE(HDRP(prev))));
+				CLR_PFREE(HDRP(NEXT_BLKP(prev)));
+				memmove(prev, bp, size - OVERHEAD);
+				realloc_trim(prev, asize);
+				mark_dirty(prev);
+				arena->counters.realloc_backward++;
+				return prev;
+			}
+		}
+
+		// extend the heap by the shortfall if bp is the last block
+		if (GET_SIZE(HDRP(nsize ? NEXT_BLKP(next) : next)) != 0) {
+			return NULL;
+		}
+		if (extend_heap((asize - size - nsize)/WSIZE) == NULL) {
+			return NULL;
+		}
+		nsize = GET_SIZE(HDRP(next));
+		arena->counters.realloc_extend++;
+	} else {
+		arena->counters.realloc_forward++;
+	}
+
+	// absorb the next block
+	remove_free(next);
+	PUT(HDRP(bp), PACK(size + nsize, GET_PFREE(HDRP(bp))));
+	CLR_PFREE(HDRP(NEXT_BLKP(bp)));
+	realloc_trim(bp, asize);
+	mark_dirty(bp);
+	return bp;
+}
+
+#if USE_HEADROOM
+/*
+ * headroom_adapt - Counts a headroom grant and, every HEADROOM_WINDOW
+ *         grants, halves the headroom if it served fewer reallocs
+ *         than there were grants, or doubles it if it served over
+ *         four per grant and blocks still outgrew it.
+ */
+static void headroom_adapt(void)
+{
+	if (++arena->window_grants < HEADROOM_WINDOW) {
+		return;
+	}
+	if (arena->window_hits < arena->window_grants && arena->headroom_shift < HEADROOM_MAX_SHIFT) {
+		arena->headroom_shift++;
+	} else if (arena->window_hits > 4 * arena->window_grants && arena->headroom_shift > HEADROOM_MIN_SHIFT) {
+		arena->headroom_shift--;
+	}
+	arena->window_grants = arena->window_hits = 0;
+}
+#endif
+
+/*
+ * map_malloc - Allocate a block with at least size bytes of payload
+ *         in a mapping of its own
+ */
+static void *map_malloc(size_t size)
+{
+	size_t msize = MAP_SIZE(size);
+	char *bp;
+
+	if ((bp = mem_map(msize)) == NULL) {
+		return NULL;
+	}
+	bp += ALIGNSIZE;
+	PUT(HDRP(bp), PACK(msize, 0));
+	arena->counters.mapped_blocks++;
+	return bp;
+}
+
+/*
+ * map_free - Unmaps a block from map_malloc()
+ */
+static void map_free(void *bp)
+{
+	mem_unmap((char *)bp - ALIGNSIZE, GET_SIZE(HDRP(bp)));
+}
+
+/*
+ * map_realloc - Resizes a block from map_malloc(). It stays mapped,
+ *         moved by mem_remap() if it has to, unless it drops below
+ *         MMAP_THRESHOLD, when it is copied into the heap.
+ */
+static void *map_realloc(void *bp, size_t size)
+{
+	size_t oldsize = GET_SIZE(HDRP(bp));
+	size_t msize = MAP_SIZE(size);
+	char *newp;
+
+	if (size < MMAP_THRESHOLD) {
+		if ((newp = arena_malloc(size)) == NULL) {
+			return NULL;
+		}
+		mm_memcpy(newp, bp, size);
+		map_free(bp);
+		return newp;
+	}
+
+	if (msize == oldsize) {
+		arena->counters.realloc_inplace++;
+		return bp;
+	}
+	if ((newp = mem_remap((char *)bp - ALIGNSIZE, oldsize, msize)) == NULL) {
+		return NULL;
+	}
+	if (newp + ALIGNSIZE == (char *)bp) {
+		arena->counters.realloc_inplace++;
+	} else {
+		arena->counters.map_moves++;
+	}
+	bp = newp + ALIGNSIZE;
+	PUT(HDRP(bp), PACK(msize, 0));
+	return bp;
+}
+
+/* 
+ * check_arena - Check the heap of the current arena for consistency 
+ */
+static void check_arena(int verbose) 
+{
+	printf("\n");
+
+	char *bp = arena->heap_listp;
+
+	if (verbose){
+		printf("Heap (%p):\n", arena->heap_listp);
+	}
+
+	// Check if prologue header is good
+	if ((GET_SIZE(HDRP(arena->heap_listp)) != DSIZE) || GET_FREE(HDRP(arena->heap_listp))){
+		printf("Bad prologue header\n");
+	}
+	
+	// check the free block index, count the blocks in it
+	int listCount = check_lists();
+
+	int freeCount = 0;
+	int purgeCount = 0;
+	size_t freeBytes = 0;
+	for (bp = arena->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+		// the next block must know whether this one is free
+		if(!GET_FREE(HDRP(bp)) != !GET_PFREE(HDRP(NEXT_BLKP(bp)))){
+			printf("%p prev free bit of next block is wrong!\n", bp);
+		}
+#if USE_SLAB
+		if(!GET_FREE(HDRP(bp)) && IS_SLAB(bp)){
+			check_slab(bp);
+		}
+#endif
+		if(GET_FREE(HDRP(bp))){
+			freeCount++;
+			freeBytes += GET_SIZE(HDRP(bp));
+			purgeCount += (GET(HDRP(bp)) & PURGE_BIT) != 0;
+			if(GET(FTRP(bp)) != PACK(GET_SIZE(HDRP(bp)), FREE_BIT)){
+				printf("%p header does not match footer!\n", bp);
+			}
+			// adjacent free blocks should have been coalesced
+			if(GET_FREE(HDRP(NEXT_BLKP(bp)))){
+				printf("%p and %p are free but not coalesced!\n", bp, NEXT_BLKP(bp));
+			}
+		}
+		if (verbose){
+			printblock(bp);
+		}
+	}
+
+	// the wilderness is the last block if that is free, and is in no list
+	if(arena->wild != (GET_PFREE(HDRP(bp)) ? PREV_BLKP(bp) : NULL)){
+		printf("%p should be the wilderness, not %p!\n", GET_PFREE(HDRP(bp)) ? PREV_BLKP(bp) : NULL, arena->wild);
+	}
+	listCount += (arena->wild != NULL);
+	if(arena->wild != NULL){
+		freeBytes -= GET_SIZE(HDRP(arena->wild));
+	}
+	if(freeBytes != arena->free_bytes){
+		printf("%zu bytes in indexed free blocks but %zu counted!\n", freeBytes, arena->free_bytes);
+	}
+#if PURGE_DECAY
+	// every free block marked for purging must be on the list, once
+	if(check_purge() != purgeCount){
+		printf("%d free blocks marked for purging but a different number on the list!\n", purgeCount);
+	}
+#endif
+#if FAST_MAX
+	check_fast();
+#endif
+
+	// every free block must be in exactly one list
+	if(freeCount != listCount){
+		printf("%d free blocks in heap but %d in lists!\n", freeCount, listCount);
+	}
+#if USE_SLAB
+	check_slabs();
+#endif
+
+	if (verbose){
+		printblock(bp);
+	}
+	if ((GET_SIZE(HDRP(bp)) != 0) || (GET_FREE(HDRP(bp)))){
+		printf("Bad epilogue header\n");
+	}
+}
+
+#if USE_SLAB
+/*********************************************************
+ * Small object slabs
+ *
+ * Requests of up to SLAB_MAX bytes are rounded up to one of
+ * NUM_SLAB_CLASSES object sizes and served from slabs, each
+ * a SLAB_SIZE aligned page taken from the heap as an
+ * ordinary allocated block. A slab starts with a slab_t
+ * holding a bitmap of its free objects, the objects follow
+ * with no header of their own. The slab block is exactly a
+ * page long, so the next block's header alone ends the page
+ * and slabs carved one after another are adjacent.
+ * slab_map has a byte per heap
+ * page that is set when the page is a slab, so mm_free()
+ * can tell slab objects from heap blocks by address alone.
+ * Slabs with free objects are kept in a list per class,
+ * empty slabs are given back to the heap.
+ *********************************************************/
+
+/**
+ * slab_class - Returns the slab class for requests of size bytes
+ */
+static int slab_class(size_t size)
+{
+	int class = 0;
+
+	while (slab_sizes[class] * ALIGNSIZE < size) {
+		class++;
+	}
+	return class;
+}
+
+/**
+ * slab_link - Puts slab on the front of its class list
+ */
+static void slab_link(slab_t *slab)
+{
+	int class = slab_class(slab->size);
+
+	slab->prev = NULL;
+	slab->next = arena->slab_listp[class];
+	if (slab->next != NULL) {
+		slab->next->prev = slab;
+	}
+	arena->slab_listp[class] = slab;
+}
+
+/**
+ * slab_unlink - Takes slab off its class list
+ */
+static void slab_unlink(slab_t *slab)
+{
+	if (slab->prev == NULL) {
+		arena->slab_listp[slab_class(slab->size)] = slab->next;
+	} else {
+		slab->prev->next = slab->next;
+	}
+	if (slab->next != NULL) {
+		slab->next->prev = slab->prev;
+	}
+}
+
+/**
+ * slab_new - Carves a new slab for class out of the heap
+ */
+static slab_t *slab_new(int class)
+{
+	/* the next block's header ends the page */
+	slab_t *slab = malloc_aligned(SLAB_SIZE, SLAB_SIZE);
+
+	if (slab == NULL) {
+		return NULL;
+	}
+
+	slab->size = slab_sizes[class] * ALIGNSIZE;
+	slab->nobjs = SLAB_NOBJS(slab->size);
+	slab->nfree = slab->nobjs;
+	memset(slab->bitmap, 0, sizeof(slab->bitmap));
+	for (int i = 0; i < slab->nobjs; i++) {
+		slab->bitmap[i / 32] |= 1U << (i % 32);
+	}
+	arena->slab_map[SLAB_PAGE(slab)] = 1;
+	slab_link(slab);
+	return slab;
+}
+
+/**
+ * slab_malloc - Allocates an object of at least size bytes from a slab
+ */
+static void *slab_malloc(size_t size)
+{
+	int class = slab_class(size);
+	slab_t *slab = arena->slab_listp[class];
+
+	if (slab == NULL && (slab = slab_new(class)) == NULL) {
+		return NULL;
+	}
+
+	int w = 0;
+	while (slab->bitmap[w] == 0) {
+		w++;
+	}
+	int i = w * 32 + FFS(slab->bitmap[w]);
+	slab->bitmap[w] &= ~(1U << (i % 32));
+
+	// full slabs are taken off the list until an object is freed
+	if (--slab->nfree == 0) {
+		slab_unlink(slab);
+	}
+	return (char *)slab + SLAB_HDR + i * slab->size;
+}
+
+/**
+ * slab_free - Returns a slab object, gives the slab back to the heap
+ * once all of its objects are free
+ */
+static void slab_free(void *bp)
+{
+	slab_t *slab = SLAB_OF(bp);
+	int i = ((char *)bp - (char *)slab - SLAB_HDR) / slab->size;
+
+	if (slab->bitmap[i / 32] & (1U << (i % 32))) {
+		fprintf(stderr, "slab_free(): memory not alloced or corrupted");
+		return;
+	}
+	slab->bitmap[i / 32] |= 1U << (i % 32);
+
+	if (slab->nfree++ == 0) {
+		slab_link(slab);
+	}
+	// keep a class's only slab to avoid refilling it on the next malloc
+	if (slab->nfree == slab->nobjs && (slab->prev != NULL || slab->next != NULL)) {
+		slab_unlink(slab);
+		arena->slab_map[SLAB_PAGE(slab)] = 0;
+		free_block(slab);
+	}
+}
+
+/**
+ * check_slab - Checks a slab's header against its bitmap
+ */
+static void check_slab(void *bp)
+{
+	slab_t *slab = bp;
+	int nfree = 0;
+
+	if (slab_sizes[slab_class(slab->size)] * ALIGNSIZE != slab->size ||
+		slab->nobjs != SLAB_NOBJS(slab->size)) {
+		printf("%p slab header is corrupt!\n", bp);
+		return;
+	}
+	for (int i = 0; i < slab->nobjs; i++) {
+		if (slab->bitmap[i / 32] & (1U << (i % 32))) {
+			nfree++;
+		}
+	}
+	if (nfree != slab->nfree) {
+		printf("%p slab has %d free objects but counts %d!\n", bp, nfree, slab->nfree);
+	}
+}
+
+/**
+ * check_slabs - Checks every slab in the class lists has free objects
+ */
+static void check_slabs(void)
+{
+	for (int class = 0; class < NUM_SLAB_CLASSES; class++) {
+		for (slab_t *slab = arena->slab_listp[class]; slab != NULL; slab = slab->next) {
+			if (!IS_SLAB(slab) || slab_class(slab->size) != class || slab->nfree == 0) {
+				printf("%p should not be in slab list %d!\n", slab, class);
+			}
+			if (slab->next != NULL && slab->next->prev != slab) {
+				printf("%p slab next/prev links don't match!\n", slab);
+			}
+		}
+	}
+}
+
+#endif /* USE_SLAB */
+
+/**
+ * coalesce - Merges a free block with any free neighbours
+ * 
+ * Uses the prev free bit and the boundary tags of the blocks on
+ * either side to merge in constant time, then adds the result to
+ * its free list, or makes it the wilderness, and marks it free in
+ * the next block's header.
+ */
+static void *coalesce(void *bp)
+{
+	size_t prev_free = GET_PFREE(HDRP(bp));
+	size_t next_free = GET_FREE(HDRP(NEXT_BLKP(bp)));
+	size_t size = GET_SIZE(HDRP(bp));
+
+	purge_stamp(HDRP(bp), size);
+
+	if (next_free) {				/* merge with next */
+		remove_free(NEXT_BLKP(bp));
+		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+		clear_tags(FTRP(bp));
+		PUT(HDRP(bp), PACK(size, FREE_BIT | prev_free));
+		PUT(FTRP(bp), PACK(size, FREE_BIT));
+	}
+
+	if (prev_free) {				/* merge with previous */
+		char *prev = PREV_BLKP(bp);
+		clear_tags(HDRP(bp) - WSIZE);
+		bp = prev;
+		remove_free(bp);
+		size += GET_SIZE(HDRP(bp));
+		PUT(HDRP(bp), PACK(size, FREE_BIT));
+		PUT(FTRP(bp), PACK(size, FREE_BIT));
+	}
+
+	SET_PFREE(HDRP(NEXT_BLKP(bp)));
+	add_free(bp);
+	return bp;
+}
+
+/*
+ * clear_tags - Zeroes the 4 words at p, a footer, the header after it
+ *         and that block's links, once they are inside a merged free
+ *         block. Only needed where they may be above zero_lo.
+ */
+static void clear_tags(char *p)
+{
+	if (p + 4*WSIZE > arena->zero_lo) {
+		memset(p, 0, 4*WSIZE);
+	}
+}
+
+/*
+ * mark_dirty - Moves zero_lo past allocated block bp, which its user
+ *         may write anywhere
+ */
+static void mark_dirty(void *bp)
+{
+	char *end = HDRP(NEXT_BLKP(bp));
+
+	if (end > arena->zero_lo) {
+		arena->zero_lo = end;
+	}
+}
+
+/**
+ * adjust_size - Returns the block size needed for a payload of size
+ * bytes, including the header and rounded for alignment
+ */
+static size_t adjust_size(size_t size)
+{
+	return MAX(MINSIZE, ALIGNSIZE * ((size + OVERHEAD + (ALIGNSIZE-1)) / ALIGNSIZE));
+}
+
+#if !USE_TLSF && !USE_TREE && !USE_SCAN
+/*********************************************************
+ * Segregated free lists
+ *********************************************************/
+
+/**
+ * clear_lists - Empties every size class list
+ */
+static void clear_lists(void)
+{
+	memset(arena->seg_listp, 0, sizeof(arena->seg_listp));
+	arena->rover = NULL;
+}
+
+/**
+ * size_class - Returns the index of the free list for blocks of size
+ */
+static int size_class(size_t size)
+{
+	int class = 0;
+
+	size /= MINSIZE;
+	while (class < NUM_CLASSES - 1 && size > 1) {
+		size >>= 1;
+		class++;
+	}
+	return class;
+}
+
+/**
+ * add_to_list - Adds free block to the front of its size class list,
+ * or in address order under the "address" policy
+ */
+static void add_to_list(void* bp){
+
+	// case for nothing to add
+	if(bp == NULL || !GET_FREE(HDRP(bp))){
+		fprintf(stderr, "add_to_list(): Pointer is null or not free\n");
+		return;
+	}
+
+	int class = size_class(GET_SIZE(HDRP(bp)));
+	char *prev = NULL;
+	char *next = arena->seg_listp[class];
+
+	if(fit_policy == FIT_ADDRESS){
+		while(next != NULL && next < (char *)bp){
+			prev = next;
+			next = GET_NEXT_FREE(next);
+		}
+	}
+	SET_NEXT_FREE(bp, next);
+	SET_PREV_FREE(bp, prev);
+	if(next != NULL){
+		SET_PREV_FREE(next, bp);
+	}
+	if(prev != NULL){
+		SET_NEXT_FREE(prev, bp);
+	} else {
+		arena->seg_listp[class] = bp;
+	}
+}
+
+/**
+ * remove_from_list - Removes free block from its size class list
+ * 
+ * The block's size must not have changed since it was added.
+ */
+static void remove_from_list(void* bp){
+
+	// case for nothing to remove
+	if(bp == NULL){
+		fprintf(stderr, "remove_from_list(): List is free or memory is corrupt\n");
+		return;
+	}
+
+	char *next = GET_NEXT_FREE(bp);
+	char *prev = GET_PREV_FREE(bp);
+
+	if(bp == arena->rover){
+		arena->rover = next;
+	}
+	if(prev == NULL){ /* case for head being removed */
+		arena->seg_listp[size_class(GET_SIZE(HDRP(bp)))] = next;
+	} else {
+		SET_NEXT_FREE(prev, next);
+	}
+	if(next != NULL){
+		SET_PREV_FREE(next, prev);
+	}
+}
+
+/**
+ * fit_done - Returns whether a list search under the current policy
+ * can stop at a block of size bytes, the best fit so far for asize
+ */
+static int fit_done(size_t size, size_t asize)
+{
+	switch (fit_policy) {
+	case FIT_BEST:
+		return size == asize;
+	case FIT_GOOD:
+		return size - asize <= (asize >> GOOD_FIT_SHIFT);
+	default:
+		// with a probe limit every policy keeps the best it sees
+		return probe_limit == 0 || size == asize;
+	}
+}
+
+/**
+ * scan_list - Searches the list of class for a block of at least
+ * asize bytes under the current policy, starting at start and
+ * wrapping round to it. Looks at no more than probe_limit blocks.
+ */
+static char *scan_list(int class, char *start, size_t asize)
+{
+	char *bp = start;
+	char *best = NULL;
+	int probes = 0;
+
+	while (bp != NULL) {
+		size_t size = GET_SIZE(HDRP(bp));
+		probes++;
+		if (size >= asize && (best == NULL || size < GET_SIZE(HDRP(best)))) {
+			best = bp;
+			if (fit_done(size, asize)) {
+				break;
+			}
+		}
+		if ((bp = GET_NEXT_FREE(bp)) == NULL && start != arena->seg_listp[class]) {
+			bp = arena->seg_listp[class];
+		}
+		if (bp == start) {
+			break;
+		}
+		if (probes == probe_limit && bp != NULL) {
+			arena->counters.fit_cutoffs++;
+			break;
+		}
+	}
+	arena->counters.fit_probes += probes;
+	return best;
+}
+
+/* 
+ * find_fit - Find a fit for a block with asize bytes 
+ *
+ * Only the lists whose class can hold asize are searched. The
+ * first list is scanned as fit_policy says, from the rover for
+ * next fit. Any block in a larger class is big enough, so the
+ * head of the first non empty one is taken, or its lowest address
+ * block of all of them for address order, or its smallest for
+ * best fit. With a probe limit a scan looks at no more than
+ * probe_limit blocks and takes the best fit among them.
+ */
+static void *find_fit(size_t asize)
+{
+	int class = size_class(asize);
+	char *start = arena->seg_listp[class];
+	char *bp;
+
+	if (fit_policy == FIT_NEXT && arena->rover != NULL && size_class(GET_SIZE(HDRP(arena->rover))) == class) {
+		start = arena->rover;
+	}
+	if ((bp = scan_list(class, start, asize)) == NULL) {
+		/* Every block in a larger class fits */
+		for (class++; class < NUM_CLASSES && arena->seg_listp[class] == NULL; class++)
+			;
+		if (class == NUM_CLASSES) {
+			return NULL; /* no fit */
+		}
+		bp = arena->seg_listp[class];
+		if (fit_policy == FIT_BEST) {
+			bp = scan_list(class, bp, asize);
+		} else if (fit_policy == FIT_ADDRESS) {
+			for (class++; class < NUM_CLASSES; class++) {
+				if (arena->seg_listp[class] != NULL && arena->seg_listp[class] < bp) {
+					bp = arena->seg_listp[class];
+				}
+			}
+		}
+	}
+	arena->rover = bp;
+	return bp;
+}
+
+/**
+ * check_lists - Checks every block in the free lists is actually
+ * free and in the right class, returns the number of listed blocks
+ */
+static int check_lists(void)
+{
+	int listCount = 0;
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		for (char *node = arena->seg_listp[i]; node != NULL; node = GET_NEXT_FREE(node)) {
+			if(!GET_FREE(HDRP(node))){
+				printf("%p not free but is in list!\n", node);
+			}
+			if(size_class(GET_SIZE(HDRP(node))) != i){
+				printf("%p is in list %d but belongs in %d!\n", node, i, size_class(GET_SIZE(HDRP(node))));
+			}
+			if(GET_NEXT_FREE(node) != NULL && GET_PREV_FREE(GET_NEXT_FREE(node)) != node){
+				printf("%p next/prev links don't match!\n", node);
+			}
+			listCount++;
+		}
+	}
+	return listCount;
+}
+
+#elif USE_TLSF
+/*********************************************************
+ * Two-level segregated fit
+ *
+ * The first level splits sizes by power of two, the second
+ * splits each power of two range into SL_COUNT equal bins.
+ * Sizes below SMALL_BLOCK all go in first level 0, binned
+ * linearly by ALIGNSIZE. A bit is set in fl_bitmap for every
+ * first level with a non empty bin, and in sl_bitmap[fl]
+ * for every non empty bin of that level, so a fit is found
+ * with two find-first-set operations.
+ *********************************************************/
+
+/**
+ * tlsf_mapping - Computes the first and second level index of size
+ */
+static void tlsf_mapping(size_t size, int *fl, int *sl)
+{
+	if (size < SMALL_BLOCK) {
+		*fl = 0;
+		*sl = size / ALIGNSIZE;
+	} else {
+		int msb = FLS(size);
+		*fl = msb - FLS(SMALL_BLOCK) + 1;
+		*sl = (size >> (msb - SL_BITS)) ^ SL_COUNT;
+	}
+}
+
+/**
+ * clear_lists - Empties every bin and clears the bitmaps
+ */
+static void clear_lists(void)
+{
+	arena->fl_bitmap = 0;
+	memset(arena->sl_bitmap, 0, sizeof(arena->sl_bitmap));
+	memset(arena->tlsf_listp, 0, sizeof(arena->tlsf_listp));
+}
+
+/**
+ * add_to_list - Adds free block to the front of its bin
+ */
+static void add_to_list(void* bp){
+
+	// case for nothing to add
+	if(bp == NULL || !GET_FREE(HDRP(bp))){
+		fprintf(stderr, "add_to_list(): Pointer is null or not free\n");
+		return;
+	}
+
+	int fl, sl;
+	tlsf_mapping(GET_SIZE(HDRP(bp)), &fl, &sl);
+	char *head = arena->tlsf_listp[fl][sl];
+
+	SET_NEXT_FREE(bp, head);
+	SET_PREV_FREE(bp, NULL);
+	if(head != NULL){
+		SET_PREV_FREE(head, bp);
+	}
+	arena->tlsf_listp[fl][sl] = bp;
+	arena->fl_bitmap |= 1U << fl;
+	arena->sl_bitmap[fl] |= 1U << sl;
+}
+
+/**
+ * remove_from_list - Removes free block from its bin
+ *
+ * The block's size must not have changed since it was added.
+ */
+static void remove_from_list(void* bp){
+
+	// case for nothing to remove
+	if(bp == NULL){
+		fprintf(stderr, "remove_from_list(): List is free or memory is corrupt\n");
+		return;
+	}
+
+	char *next = GET_NEXT_FREE(bp);
+	char *prev = GET_PREV_FREE(bp);
+
+	if(prev == NULL){ /* case for head being removed */
+		int fl, sl;
+		tlsf_mapping(GET_SIZE(HDRP(bp)), &fl, &sl);
+		arena->tlsf_listp[fl][sl] = next;
+		if(next == NULL){ /* bin is now empty */
+			arena->sl_bitmap[fl] &= ~(1U << sl);
+			if(arena->sl_bitmap[fl] == 0){
+				arena->fl_bitmap &= ~(1U << fl);
+			}
+		}
+	} else {
+		SET_NEXT_FREE(prev, next);
+	}
+	if(next != NULL){
+		SET_PREV_FREE(next, prev);
+	}
+}
+
+/*
+ * find_fit - Find a fit for a block with asize bytes
+ *
+ * The head of asize's own bin is taken if it is big enough. Else
+ * asize is rounded up to the next bin boundary so that any block
+ * in the bin found is big enough, then the first non empty bin at
+ * or above it is located through the bitmaps without a search.
+ */
+static void *find_fit(size_t asize)
+{
+	int fl, sl;
+	unsigned int map;
+
+	tlsf_mapping(asize, &fl, &sl);
+	if (fl < FL_COUNT && arena->tlsf_listp[fl][sl] != NULL &&
+		GET_SIZE(HDRP(arena->tlsf_listp[fl][sl])) >= asize) {
+		return arena->tlsf_listp[fl][sl];
+	}
+
+	if (asize >= SMALL_BLOCK) {
+		asize += ((size_t)1 << (FLS(asize) - SL_BITS)) - 1;
+	}
+	tlsf_mapping(asize, &fl, &sl);
+	if (fl >= FL_COUNT) {
+		return NULL;
+	}
+
+	/* Non empty bins of this first level at or above sl */
+	map = arena->sl_bitmap[fl] & (~0U << sl);
+	if (!map) {
+		/* Otherwise the smallest non empty larger first level */
+		map = arena->fl_bitmap & (~0U << (fl + 1));
+		if (!map) {
+			return NULL; /* no fit */
+		}
+		fl = FFS(map);
+		map = arena->sl_bitmap[fl];
+	}
+	sl = FFS(map);
+
+	return arena->tlsf_listp[fl][sl];
+}
+
+/**
+ * check_lists - Checks every block in the bins is actually free and
+ * in the right bin, and that the bitmaps match the bins, returns the
+ * number of listed blocks
+ */
+static int check_lists(void)
+{
+	int listCount = 0;
+	for (int fl = 0; fl < FL_COUNT; fl++) {
+		if (!(arena->fl_bitmap & (1U << fl)) != !arena->sl_bitmap[fl]) {
+			printf("first level bitmap wrong for %d!\n", fl);
+		}
+		for (int sl = 0; sl < SL_COUNT; sl++) {
+			if (!(arena->sl_bitmap[fl] & (1U << sl)) != !arena->tlsf_listp[fl][sl]) {
+				printf("second level bitmap wrong for %d/%d!\n", fl, sl);
+			}
+			for (char *node = arena->tlsf_listp[fl][sl]; node != NULL; node = GET_NEXT_FREE(node)) {
+				int nfl, nsl;
+				if(!GET_FREE(HDRP(node))){
+					printf("%p not free but is in list!\n", node);
+				}
+				tlsf_mapping(GET_SIZE(HDRP(node)), &nfl, &nsl);
+				if(nfl != fl || nsl != sl){
+					printf("%p is in bin %d/%d but belongs in %d/%d!\n", node, fl, sl, nfl, nsl);
+				}
+				if(GET_NEXT_FREE(node) != NULL && GET_PREV_FREE(GET_NEXT_FREE(node)) != node){
+					printf("%p next/prev links don't match!\n", node);
+				}
+				listCount++;
+			}
+		}
+	}
+	return listCount;
+}
+
+#elif USE_SCAN
+/*********************************************************
+ * SIMD scanned size array
+ *
+ * The size of every free block is kept in scan_size[] and
+ * its offset in scan_link[] at the same slot, and the block
+ * keeps its slot where the next link would be. A block is
+ * removed by moving the last slot into its place, and slots
+ * past scan_count are zero so that no block fits them. The
+ * array is split into chunks of SCAN_CHUNK slots with the
+ * largest size of each in scan_max[]. find_fit() takes the
+ * first chunk that holds a fit and compares its sizes 8
+ * (AVX2) or 4 (SSE4.1) at a time for the smallest that fits,
+ * so the only block header it reads is the winner's. The
+ * arrays are mapped when their arena is first set up, with
+ * room for every block the region can hold, but only the
+ * pages of the slots in use ever take memory.
+ *********************************************************/
+
+/**
+ * scan_chunk_words - Returns the slot of the smallest of the
+ * SCAN_CHUNK sizes at p that is at least need, or -1
+ */
+static int scan_chunk_words(const unsigned int *p, unsigned int need)
+{
+	unsigned int best = UINT32_MAX;
+	int slot = -1;
+
+	for (int i = 0; i < SCAN_CHUNK; i++) {
+		if (p[i] >= need && p[i] < best) {
+			best = p[i];
+			slot = i;
+		}
+	}
+	return slot;
+}
+
+#if HAVE_X86
+/**
+ * scan_chunk_sse41 - scan_chunk_words() 4 sizes at a time
+ */
+__attribute__((target("sse4.1")))
+static int scan_chunk_sse41(const unsigned int *p, unsigned int need)
+{
+	__m128i want = _mm_set1_epi32(need - 1);
+	__m128i best = _mm_set1_epi32(-1);
+	unsigned int min;
+
+	// sizes are below 2^31, so the signed compare is safe
+	for (int i = 0; i < SCAN_CHUNK; i += 4) {
+		__m128i v = _mm_load_si128((const __m128i *)(p + i));
+		__m128i fits = _mm_cmpgt_epi32(v, want);
+		best = _mm_min_epu32(best, _mm_or_si128(v, _mm_andnot_si128(fits, _mm_set1_epi32(-1))));
+	}
+	best = _mm_min_epu32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+	best = _mm_min_epu32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+	if ((min = _mm_cvtsi128_si32(best)) == UINT32_MAX) {
+		return -1;
+	}
+	for (int i = 0; ; i += 4) {
+		__m128i v = _mm_load_si128((const __m128i *)(p + i));
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, best)));
+		if (mask != 0) {
+			return i + FFS(mask);
+		}
+	}
+}
+
+/**
+ * scan_chunk_avx2 - scan_chunk_words() 8 sizes at a time
+ */
+__attribute__((target("avx2")))
+static int scan_chunk_avx2(const unsigned int *p, unsigned int need)
+{
+	__m256i want = _mm256_set1_epi32(need - 1);
+	__m256i best = _mm256_set1_epi32(-1);
+	__m128i half;
+	unsigned int min;
+
+	for (int i = 0; i < SCAN_CHUNK; i += 8) {
+		__m256i v = _mm256_load_si256((const __m256i *)(p + i));
+		__m256i fits = _mm256_cmpgt_epi32(v, want);
+		best = _mm256_min_epu32(best, _mm256_or_si256(v, _mm256_andnot_si256(fits, _mm256_set1_epi32(-1))));
+	}
+	half = _mm_min_epu32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_min_epu32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	if ((min = _mm_cvtsi128_si32(half)) == UINT32_MAX) {
+		return -1;
+	}
+	best = _mm256_set1_epi32(min);
+	for (int i = 0; ; i += 8) {
+		__m256i v = _mm256_load_si256((const __m256i *)(p + i));
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, best)));
+		if (mask != 0) {
+			return i + FFS(mask);
+		}
+	}
+}
+#endif
+
+/**
+ * clear_lists - Empties the size array
+ */
+static void clear_lists(void)
+{
+	memset(arena->scan_size, 0, (arena->scan_count + SCAN_CHUNK - 1) / SCAN_CHUNK * SCAN_CHUNK * sizeof(*arena->scan_size));
+	memset(arena->scan_max, 0, (arena->scan_count + SCAN_CHUNK - 1) / SCAN_CHUNK * sizeof(*arena->scan_max));
+	arena->scan_count = 0;
+}
+
+/**
+ * scan_map - Maps the size array of the current arena, returns -1
+ * if it cannot
+ */
+static int scan_map(void)
+{
+	size_t bytes = (2 * SCAN_SLOTS + SCAN_SLOTS / SCAN_CHUNK) * sizeof(unsigned int);
+	unsigned int *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+						   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "arena_init(): cannot map the size array\n");
+		return -1;
+	}
+	arena->scan_size = p;
+	arena->scan_link = p + SCAN_SLOTS;
+	arena->scan_max = p + 2 * SCAN_SLOTS;
+	return 0;
+}
+
+/**
+ * scan_pick - Picks the widest scan the CPU supports, once for all
+ * arenas
+ */
+static void scan_pick(void)
+{
+	scan_chunk = scan_chunk_words;
+#if HAVE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		scan_chunk = scan_chunk_avx2;
+	} else if (__builtin_cpu_supports("sse4.1")) {
+		scan_chunk = scan_chunk_sse41;
+	}
+#endif
+}
+
+/**
+ * scan_rechunk - Recomputes the largest size in chunk c
+ */
+static void scan_rechunk(size_t c)
+{
+	unsigned int max = 0;
+
+	for (int i = 0; i < SCAN_CHUNK; i++) {
+		max = MAX(max, arena->scan_size[c * SCAN_CHUNK + i]);
+	}
+	arena->scan_max[c] = max;
+}
+
+/**
+ * add_to_list - Adds free block to the end of the size array
+ */
+static void add_to_list(void* bp){
+
+	// case for nothing to add
+	if(bp == NULL || !GET_FREE(HDRP(bp))){
+		fprintf(stderr, "add_to_list(): Pointer is null or not free\n");
+		return;
+	}
+
+	size_t slot = arena->scan_count++;
+	unsigned int size = GET_SIZE(HDRP(bp));
+
+	arena->scan_size[slot] = size;
+	arena->scan_link[slot] = TO_LINK(bp);
+	NEXT_LINK(bp) = slot;
+	arena->scan_max[slot / SCAN_CHUNK] = MAX(arena->scan_max[slot / SCAN_CHUNK], size);
+}
+
+/**
+ * remove_from_list - Removes free block from the size array, the
+ * last slot is moved into its place
+ */
+static void remove_from_list(void* bp){
+
+	// case for nothing to remove
+	if(bp == NULL){
+		fprintf(stderr, "remove_from_list(): List is free or memory is corrupt\n");
+		return;
+	}
+
+	size_t slot = NEXT_LINK(bp);
+	size_t last = --arena->scan_count;
+	unsigned int size = arena->scan_size[slot];
+	unsigned int moved = arena->scan_size[last];
+
+	arena->scan_size[slot] = moved;
+	arena->scan_link[slot] = arena->scan_link[last];
+	NEXT_LINK(TO_PTR(arena->scan_link[slot])) = slot;
+	arena->scan_size[last] = 0;
+
+	if (size == arena->scan_max[slot / SCAN_CHUNK]) {
+		scan_rechunk(slot / SCAN_CHUNK);
+	} else {
+		arena->scan_max[slot / SCAN_CHUNK] = MAX(arena->scan_max[slot / SCAN_CHUNK], arena->scan_size[slot]);
+	}
+	if (last / SCAN_CHUNK != slot / SCAN_CHUNK && moved == arena->scan_max[last / SCAN_CHUNK]) {
+		scan_rechunk(last / SCAN_CHUNK);
+	}
+}
+
+/* 
+ * find_fit - Find a fit for a block with asize bytes 
+ *
+ * Best fit within the first chunk whose largest size fits.
+ */
+static void *find_fit(size_t asize)
+{
+	size_t chunks = (arena->scan_count + SCAN_CHUNK - 1) / SCAN_CHUNK;
+
+	for (size_t c = 0; c < chunks; c++) {
+		if (arena->scan_max[c] >= asize) {
+			int i = scan_chunk(arena->scan_size + c * SCAN_CHUNK, asize);
+			return TO_PTR(arena->scan_link[c * SCAN_CHUNK + i]);
+		}
+	}
+	return NULL; /* no fit */
+}
+
+/**
+ * check_lists - Checks every slot holds a free block of its size
+ * that knows its slot, and the chunk maxima, returns the number
+ * of blocks in the array
+ */
+static int check_lists(void)
+{
+	size_t chunks = (arena->scan_count + SCAN_CHUNK - 1) / SCAN_CHUNK;
+
+	for (size_t slot = 0; slot < chunks * SCAN_CHUNK; slot++) {
+		char *node = TO_PTR(arena->scan_link[slot]);
+		if (slot >= arena->scan_count) {
+			if (arena->scan_size[slot] != 0) {
+				printf("slot %zu is past the end but has size %u!\n", slot, arena->scan_size[slot]);
+			}
+			continue;
+		}
+		if(!GET_FREE(HDRP(node))){
+			printf("%p not free but is in slot %zu!\n", node, slot);
+		}
+		if(GET_SIZE(HDRP(node)) != arena->scan_size[slot] || NEXT_LINK(node) != slot){
+			printf("%p does not match slot %zu!\n", node, slot);
+		}
+	}
+	for (size_t c = 0; c < chunks; c++) {
+		unsigned int max = arena->scan_max[c];
+		scan_rechunk(c);
+		if (max != arena->scan_max[c]) {
+			printf("chunk %zu has largest size %u but records %u!\n", c, arena->scan_max[c], max);
+		}
+	}
+	return arena->scan_count;
+}
+
+#else /* USE_TREE */
+/*********************************************************
+ * Size ordered tree
+ *
+ * Free blocks form a treap (a Cartesian tree) keyed by
+ * (size, address), the left and right children are kept
+ * where the list links would be, as offsets like them. Each
+ * node's priority is a hash of its address and is never above
+ * its parent's, which keeps the expected depth logarithmic
+ * without storing any balance information, so every block
+ * fits in MINSIZE.
+ *********************************************************/
+
+/* Left/right child links of a free block (bp) in the tree */
+#define TREE_LEFT(bp)		NEXT_LINK(bp)
+#define TREE_RIGHT(bp)		PREV_LINK(bp)
+
+/* Heap priority of a free block (bp) */
+#define TREE_PRIO(bp)		((unsigned int)(((uintptr_t)(bp) >> 3) * 2654435761u))
+
+/* Does block a order before block b */
+#define TREE_LESS(a, b)		(GET_SIZE(HDRP(a)) < GET_SIZE(HDRP(b)) || \
+							(GET_SIZE(HDRP(a)) == GET_SIZE(HDRP(b)) && (char *)(a) < (char *)(b)))
+
+/**
+ * clear_lists - Empties the tree
+ */
+static void clear_lists(void)
+{
+	arena->tree_root = 0;
+}
+
+/**
+ * add_to_list - Inserts free block into the tree
+ *
+ * Descends until a node of lower priority is found, then splits
+ * that subtree by key into the new block's children.
+ */
+static void add_to_list(void* bp){
 
-	// case for nothing to add or empty list
-	if(bp == NULL || !GET_ALLOC(HDRP(bp))){
+	// case for nothing to add
+	if(bp == NULL || !GET_FREE(HDRP(bp))){
 		fprintf(stderr, "add_to_list(): Pointer is null or not free\n");
 		return;
 	}
 
-	/**
-	 * If list is empty, set head to free bp,
-	 * then add next and prev pointers.
-	 */ 
-	if(free_listp == NULL){
-		free_listp = bp;
-		SET_NEXT_FREE(free_listp, free_listp);
-		SET_PREV_FREE(free_listp, free_listp);
-		return;
-	}
-	
-	// case for 1 node in list.
-	if(free_listp == GET_NEXT_FREE(free_listp)){
-		//make sure they're not next to eachother
-		if((char *) NEXT_BLKP(bp) == free_listp){
-			size_t size = GET_SIZE(HDRP(free_listp)) + GET_SIZE(HDRP(bp));
-			PUT(HDRP(bp), PACK(size, 1));
-			PUT(FTRP(bp), PACK(size, 1));
-			free_listp = bp;
-			SET_NEXT_FREE(free_listp, free_listp);
-			SET_PREV_FREE(free_listp, free_listp);
-			return;
-		} else if((char *) PREV_BLKP(bp) == free_listp){
-			size_t size = GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(bp));
-			PUT(HDRP(free_listp), PACK(size, 1));
-			PUT(FTRP(free_listp), PACK(size, 1));
-			return;
-		}
-		// Set head next to new
-		SET_NEXT_FREE(free_listp, bp);
-		// Set pre prev as new
-		SET_PREV_FREE(free_listp, bp);
-		// Set new next as head
-		SET_NEXT_FREE(bp, free_listp);
-		// Set new prev as head
-		SET_PREV_FREE(bp, free_listp);
-		return;
+	unsigned int prio = TREE_PRIO(bp);
+	unsigned int *link = &arena->tree_root;
+	char *node;
+	while ((node = TO_PTR(*link)) != NULL && TREE_PRIO(node) >= prio) {
+		link = TREE_LESS(bp, node) ? &TREE_LEFT(node) : &TREE_RIGHT(node);
 	}
 
-	/**
-	 * If previous cases don't apply, move head through list until
-	 * the new bp is in between two addresses.
-	 */ 
-	char * node = free_listp;
-	do
-	{	
-		if((char *) bp > node){
-			if((char *) bp < GET_NEXT_FREE(node) || node > GET_NEXT_FREE(node)){
-				if((char *) PREV_BLKP(bp) == node && (char *) NEXT_BLKP(bp) == GET_NEXT_FREE(node)){
-					size_t size = GET_SIZE(HDRP(node)) + GET_SIZE(HDRP(bp)) + GET_SIZE(HDRP(GET_NEXT_FREE(node)));
-					PUT(HDRP(node), PACK(size, 1));
-					PUT(FTRP(node), PACK(size, 1));
-					remove_from_list(GET_NEXT_FREE(node));
-					free_listp = node;
-					return;
-				} else if((char *) PREV_BLKP(bp) == node && (char *) NEXT_BLKP(bp) != GET_NEXT_FREE(node) && GET_ALLOC(HDRP(NEXT_BLKP(bp)))){
-					size_t size = GET_SIZE(HDRP(node)) + GET_SIZE(HDRP(bp));
-					PUT(HDRP(node), PACK(size, 1));
-					PUT(FTRP(node), PACK(size, 1));
-					free_listp = node;
-					return;
-				} else if((char *) PREV_BLKP(bp) != node && (char *) NEXT_BLKP(bp) == GET_NEXT_FREE(node)){
-					size_t size = GET_SIZE(HDRP(bp)) + GET_SIZE(HDRP(GET_NEXT_FREE(node)));
-					PUT(HDRP(bp), PACK(size, 1));
-					PUT(FTRP(bp), PACK(size, 1));
-					char * old = GET_NEXT_FREE(node);
-					// set next to the next of next-next
-					SET_NEXT_FREE(bp, GET_NEXT_FREE(old));
-					// set the prev of next-next node to bp
-					SET_PREV_FREE(GET_NEXT_FREE(old), bp);
-					SET_PREV_FREE(bp, node);
-					SET_NEXT_FREE(node, bp);
-					free_listp = node;
-					return;
-				}
-				/* bp inserted after node */
-				// Set new next as current next
-				SET_NEXT_FREE(bp, GET_NEXT_FREE(node));
-				// Set current next as new
-				SET_NEXT_FREE(node, bp);
-				// Set new prev as current
-				SET_PREV_FREE(bp, node);
-				// Set new next's prev as new
-				SET_PREV_FREE(GET_NEXT_FREE(bp), bp);
-				// Move head to the inserted node to keep it closer to new inserts
-				free_listp = node;
-				return;
-			}
-			node = GET_NEXT_FREE(node);
-		}
-		else if((char *) bp < node){
-			if((char *) bp > GET_PREV_FREE(node) || node < GET_PREV_FREE(node)){
-				if((char *) NEXT_BLKP(bp) == node && (char *) PREV_BLKP(bp) == GET_PREV_FREE(node)){
-					node = GET_PREV_FREE(node);
-					size_t size = GET_SIZE(HDRP(node)) + GET_SIZE(HDRP(bp)) + GET_SIZE(HDRP(GET_NEXT_FREE(node)));
-					PUT(HDRP(node), PACK(size, 1));
-					PUT(FTRP(node), PACK(size, 1));
-					remove_from_list(GET_NEXT_FREE(node));
-					free_listp = node;
-					return;
-				} else if((char *) PREV_BLKP(bp) == GET_PREV_FREE(node) && (char *) NEXT_BLKP(bp) != node){
-					node = GET_PREV_FREE(node);
-					size_t size = GET_SIZE(HDRP(node)) + GET_SIZE(HDRP(bp));
-					PUT(HDRP(node), PACK(size, 1));
-					PUT(FTRP(node), PACK(size, 1));
-					free_listp = node;
-					return;
-				} else if((char *) NEXT_BLKP(bp) == node && (char *) PREV_BLKP(bp) != GET_PREV_FREE(node)){
-					node = GET_PREV_FREE(node);
-					size_t size = GET_SIZE(HDRP(bp)) + GET_SIZE(HDRP(GET_NEXT_FREE(node)));
-					PUT(HDRP(bp), PACK(size, 1));
-					PUT(FTRP(bp), PACK(size, 1));
-					char * old = GET_NEXT_FREE(node);
-					// set next to the next of next-next
-					SET_NEXT_FREE(bp, GET_NEXT_FREE(old));
-					// set the prev of next-next node to bp
-					SET_PREV_FREE(GET_NEXT_FREE(old), bp);
-					SET_PREV_FREE(bp, node);
-					SET_NEXT_FREE(node, bp);
-					free_listp = node;
-					return;
-				}
-				/* bp inserted before node */
-				// Set new next to node
-				SET_NEXT_FREE(bp, node);
-				// Set new prev as node's prev
-				SET_PREV_FREE(bp, GET_PREV_FREE(node));
-				// Set prev as new
-				SET_NEXT_FREE(GET_PREV_FREE(bp), bp);
-				// set node prev as new
-				SET_PREV_FREE(node, bp);
-				// Move head to the inserted node to keep it closer to new inserts
-				free_listp = node;
-				return;
-			}
-			node = GET_PREV_FREE(node);
-		} else if(node == (char *) bp){
-			fprintf(stderr, "add_to_list(): %p is a duplicate\n", bp);
-			return;
+	unsigned int *left = &TREE_LEFT(bp);
+	unsigned int *right = &TREE_RIGHT(bp);
+	while (node != NULL) {
+		if (TREE_LESS(node, bp)) {
+			*left = TO_LINK(node);
+			left = &TREE_RIGHT(node);
+			node = TO_PTR(*left);
+		} else {
+			*right = TO_LINK(node);
+			right = &TREE_LEFT(node);
+			node = TO_PTR(*right);
 		}
-	} while (node != free_listp);
-
-	fprintf(stderr, "add_to_list(): failed to add %p\n", bp);
-
-	return;
+	}
+	*left = 0;
+	*right = 0;
+	*link = TO_LINK(bp);
 }
 
 /**
- * remove_from_list - Removes free block from list
- * 
+ * remove_from_list - Removes free block from the tree
+ *
+ * The block's size must not have changed since it was added.
+ * Its children are merged by priority into its place.
  */
 static void remove_from_list(void* bp){
 
-	// case for nothing to remove or empty list
-	if(bp == NULL || free_listp == NULL){
+	// case for nothing to remove
+	if(bp == NULL || arena->tree_root == 0){
 		fprintf(stderr, "remove_from_list(): List is free or memory is corrupt\n");
 		return;
 	}
 
-	if(free_listp == GET_NEXT_FREE(free_listp)){ /* case for 1 item */
-		free_listp = NULL;
-	} else {
-		/* case for head being removed */
-		if(free_listp == bp){
-			free_listp = GET_NEXT_FREE(free_listp);
+	unsigned int *link = &arena->tree_root;
+	char *node;
+	while ((node = TO_PTR(*link)) != bp) {
+		if (node == NULL) {
+			fprintf(stderr, "remove_from_list(): %p is not in the tree\n", bp);
+			return;
+		}
+		link = TREE_LESS(bp, node) ? &TREE_LEFT(node) : &TREE_RIGHT(node);
+	}
+
+	char *left = TO_PTR(TREE_LEFT(bp));
+	char *right = TO_PTR(TREE_RIGHT(bp));
+	while (left != NULL && right != NULL) {
+		if (TREE_PRIO(left) >= TREE_PRIO(right)) {
+			*link = TO_LINK(left);
+			link = &TREE_RIGHT(left);
+			left = TO_PTR(*link);
+		} else {
+			*link = TO_LINK(right);
+			link = &TREE_LEFT(right);
+			right = TO_PTR(*link);
+		}
+	}
+	*link = TO_LINK((left != NULL) ? left : right);
+}
+
+/*
+ * find_fit - Find a fit for a block with asize bytes
+ *
+ * Returns the smallest block of at least asize bytes, the lowest
+ * addressed one if several have that size.
+ */
+static void *find_fit(size_t asize)
+{
+	char *best = NULL;
+	char *node = TO_PTR(arena->tree_root);
+
+	while (node != NULL) {
+		if (GET_SIZE(HDRP(node)) >= asize) {
+			best = node;
+			node = TO_PTR(TREE_LEFT(node));
+		} else {
+			node = TO_PTR(TREE_RIGHT(node));
 		}
-		// Set next previous to current previous
-		SET_PREV_FREE(GET_NEXT_FREE(bp), GET_PREV_FREE(bp));
-		// Set previous next to current next
-		SET_NEXT_FREE(GET_PREV_FREE(bp), GET_NEXT_FREE(bp));
 	}
-	return;
+	return best;
+}
+
+/**
+ * check_subtree - Checks the order and priority of every node under
+ * node, lo and hi bound its keys, returns the number of nodes
+ */
+static int check_subtree(char *node, char *lo, char *hi)
+{
+	if (node == NULL) {
+		return 0;
+	}
+	if(!GET_FREE(HDRP(node))){
+		printf("%p not free but is in tree!\n", node);
+	}
+	if((lo != NULL && !TREE_LESS(lo, node)) || (hi != NULL && !TREE_LESS(node, hi))){
+		printf("%p is out of order in tree!\n", node);
+	}
+	char *left = TO_PTR(TREE_LEFT(node));
+	char *right = TO_PTR(TREE_RIGHT(node));
+	if((left != NULL && TREE_PRIO(left) > TREE_PRIO(node)) ||
+	   (right != NULL && TREE_PRIO(right) > TREE_PRIO(node))){
+		printf("%p has a child of higher priority!\n", node);
+	}
+	return 1 + check_subtree(left, lo, node) + check_subtree(right, node, hi);
+}
+
+/**
+ * check_lists - Checks the tree is ordered by key and by priority,
+ * returns the number of blocks in it
+ */
+static int check_lists(void)
+{
+	return check_subtree(TO_PTR(arena->tree_root), NULL, NULL);
 }
 
+#endif /* USE_TREE */
 /* 
  * extend_heap - Extend heap with free block and return its block pointer
  */
@@ -588,20 +3139,393 @@ static void *extend_heap(size_t words)
     char *bp;
     size_t size;
 	
-    /* Allocate an even number of words to maintain alignment */
-    size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
-    if ((bp = mem_sbrk(size)) == (void *)-1) 
+    /* Allocate a multiple of ALIGNSIZE to maintain alignment */
+    size = (words * WSIZE + ALIGNSIZE - 1) / ALIGNSIZE * ALIGNSIZE;
+    if ((bp = mem_sbrk_region(arena->id, size)) == (void *)-1) 
 		return NULL;
+	arena->counters.sbrks++;
+	arena->counters.sbrk_bytes += size;
 
     /* Initialize free block and the epilogue header */
-    PUT(HDRP(bp), PACK(size, 1));			/* free block header */
-	PUT(FTRP(bp), PACK(size, 1));			/* free block footer */
-    PUT(HDRP(NEXT_BLKP(bp)), PACK(8, 0));	/* new epilogue header */
-	add_to_list(bp);
-    return bp;
+    PUT(HDRP(bp), PACK(size, FREE_BIT | GET_PFREE(HDRP(bp))));	/* free block header */
+	PUT(FTRP(bp), PACK(size, FREE_BIT));	/* free block footer */
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 0));	/* new epilogue header */
+
+	/* Coalesce if the previous block was free */
+    return coalesce(bp);
 }
 /* $end mmextendheap */
 
+/*
+ * wild_fit - Returns the wilderness if it holds asize bytes, else
+ *         extends the heap so that it does. The grow step counts
+ *         what the wilderness has already, so a wilderness just short
+ *         of asize takes only the shortfall. Before the heap grows the
+ *         fast bins are coalesced, and a fit among them is used.
+ */
+static void *wild_fit(size_t asize)
+{
+	size_t have = (arena->wild != NULL) ? GET_SIZE(HDRP(arena->wild)) : 0;
+
+	if (have >= asize) {
+		return arena->wild;
+	}
+#if FAST_MAX
+	if (arena->fast_bytes > 0) {
+		char *bp;
+
+		fast_consolidate();
+		if ((bp = find_fit(asize)) != NULL) {
+			return bp;
+		}
+		have = (arena->wild != NULL) ? GET_SIZE(HDRP(arena->wild)) : 0;
+		if (have >= asize) {
+			return arena->wild;
+		}
+	}
+#endif
+	return extend_heap(MAX(grow_size(&arena->heap_grow, asize) - have, MINSIZE)/WSIZE);
+}
+
+/*
+ * free_block - Marks allocated heap block bp free and coalesces it
+ */
+static void free_block(void *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+
+	PUT(HDRP(bp), PACK(size, FREE_BIT | GET_PFREE(HDRP(bp))));
+	PUT(FTRP(bp), PACK(size, FREE_BIT));
+	coalesce(bp);
+	trim_heap();
+}
+
+#if FAST_MAX
+/*
+ * fast_pop - Returns a block of exactly asize bytes from its fast
+ *         bin, or NULL if the bin is empty
+ */
+static void *fast_pop(size_t asize)
+{
+	char *bp = arena->fast_bins[asize / ALIGNSIZE];
+
+	arena->counters.fast_mallocs++;
+	if (bp == NULL) {
+		return NULL;
+	}
+	arena->fast_bins[asize / ALIGNSIZE] = GET_NEXT_FREE(bp);
+	arena->fast_bytes -= asize;
+	arena->counters.fast_hits++;
+	return bp;
+}
+
+/*
+ * fast_push - Holds freed block bp in the fast bin for its size,
+ *         coalescing all of them once they reach FAST_LIMIT bytes
+ */
+static void fast_push(void *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+
+	// a sized free may pick the fast bins for a block grown past them
+	if (size > FAST_MAX) {
+		free_block(bp);
+		return;
+	}
+
+#if MM_DEBUG
+	for (char *fp = arena->fast_bins[size / ALIGNSIZE]; fp != NULL; fp = GET_NEXT_FREE(fp)) {
+		if (fp == bp) {
+			fprintf(stderr, "mm_free(): %p is already free\n", bp);
+			return;
+		}
+	}
+#endif
+	PUT(HDRP(bp), PACK(size, GET_PFREE(HDRP(bp))));	/* drop the grown bit */
+	SET_NEXT_FREE(bp, arena->fast_bins[size / ALIGNSIZE]);
+	arena->fast_bins[size / ALIGNSIZE] = bp;
+	if ((arena->fast_bytes += size) > FAST_LIMIT) {
+		fast_consolidate();
+	}
+}
+
+/*
+ * fast_consolidate - Frees and coalesces every block in the fast bins
+ */
+static void fast_consolidate(void)
+{
+	char *bp;
+
+	for (int i = 0; i <= FAST_MAX / ALIGNSIZE; i++) {
+		while ((bp = arena->fast_bins[i]) != NULL) {
+			arena->fast_bins[i] = GET_NEXT_FREE(bp);
+			PUT(HDRP(bp), PACK(i * ALIGNSIZE, FREE_BIT | GET_PFREE(HDRP(bp))));
+			PUT(FTRP(bp), PACK(i * ALIGNSIZE, FREE_BIT));
+			coalesce(bp);
+		}
+	}
+	arena->fast_bytes = 0;
+	arena->counters.fast_consolidations++;
+	trim_heap();
+}
+
+/*
+ * check_fast - Checks every block in the fast bins is an allocated
+ *         heap block of the bin's size, and that they add up to
+ *         fast_bytes
+ */
+static void check_fast(void)
+{
+	size_t bytes = 0;
+
+	for (int i = 0; i <= FAST_MAX / ALIGNSIZE; i++) {
+		for (char *bp = arena->fast_bins[i]; bp != NULL; bp = GET_NEXT_FREE(bp)) {
+			if (bp < arena->heap_listp || bp >= (char *)mem_region_hi(arena->id) ||
+				GET_FREE(HDRP(bp)) || GET_SIZE(HDRP(bp)) != (size_t)i * ALIGNSIZE) {
+				printf("%p should not be in fast bin %d!\n", bp, i);
+				break;
+			}
+			bytes += i * ALIGNSIZE;
+		}
+	}
+	if (bytes != arena->fast_bytes) {
+		printf("%zu bytes in fast bins but %zu counted!\n", bytes, arena->fast_bytes);
+	}
+}
+#endif
+
+/*
+ * add_free - Makes free block bp the wilderness if it ends the heap,
+ *         else adds it to the free block index
+ */
+static void add_free(void *bp)
+{
+#if PURGE_DECAY
+	purge_link(bp);
+#endif
+	if (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0) {
+		arena->wild = bp;
+	} else {
+		arena->free_bytes += GET_SIZE(HDRP(bp));
+		add_to_list(bp);
+	}
+}
+
+/*
+ * remove_free - Takes free block bp out of the free block index, or
+ *         clears the wilderness if it is bp
+ */
+static void remove_free(void *bp)
+{
+#if PURGE_DECAY
+	if (GET(HDRP(bp)) & PURGE_BIT) {
+		purge_unlink(bp);
+	}
+#endif
+	if (bp == arena->wild) {
+		arena->wild = NULL;
+	} else {
+		arena->free_bytes -= GET_SIZE(HDRP(bp));
+		remove_from_list(bp);
+	}
+}
+
+
+/*
+ * trim_heap - Gives back the free block at the end of the heap, but
+ *         for CHUNKSIZE bytes, if it is larger than TRIM_THRESHOLD
+ */
+static void trim_heap(void)
+{
+	char *bp = arena->wild;
+	size_t size, excess;
+
+	if (bp == NULL) {
+		return;
+	}
+	size = GET_SIZE(HDRP(bp));
+	if (size <= TRIM_THRESHOLD) {
+		return;
+	}
+	excess = (size - CHUNKSIZE) / mem_pagesize() * mem_pagesize();
+
+	// the footer and epilogue go past the new break, which must be zero above zero_lo
+	if (FTRP(bp) + DSIZE > arena->zero_lo) {
+		memset(FTRP(bp), 0, DSIZE);
+	}
+	if (mem_sbrk_region(arena->id, -(int)excess) == (void *)-1) {
+		return;
+	}
+	size -= excess;
+	PUT(HDRP(bp), PACK(size, FREE_BIT | (GET(HDRP(bp)) & (PFREE_BIT | PURGE_BIT))));
+	PUT(FTRP(bp), PACK(size, FREE_BIT));
+	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, PFREE_BIT));	/* new epilogue header */
+	arena->heap_grow.step = arena->heap_grow.min;	/* the live set shrank, grow gently again */
+	arena->counters.trims++;
+	arena->counters.trimmed_bytes += excess;
+}
+
+/*
+ * op_tick - Counts a malloc or free, sweeping for pages to purge
+ *         every PURGE_DECAY/4 of them
+ */
+static inline void op_tick(void)
+{
+	arena->op_clock++;
+#if PURGE_DECAY
+	if (arena->op_clock - arena->last_sweep >= MAX(PURGE_DECAY / 4, 1)) {
+		purge_sweep();
+	}
+#endif
+}
+
+/*
+ * grow_size - Returns how far to extend the heap g for a request of
+ *         need bytes that found no fit. While more than
+ *         1/2^GROW_FREE_SHIFT of the heap is free, counting the
+ *         wilderness and the fast bins, the step halves back
+ *         towards g->min. Otherwise it doubles while extensions come
+ *         within g->window ops of each other, up to 1/2^g->max_shift
+ *         of the heap.
+ */
+static size_t grow_size(grow_t *g, size_t need)
+{
+	size_t heap = mem_region_size(arena->id);
+	size_t cap = MAX(g->min, (heap >> g->max_shift) / ALIGNSIZE * ALIGNSIZE);
+	size_t free = arena->free_bytes + ((arena->wild != NULL) ? GET_SIZE(HDRP(arena->wild)) : 0);
+
+#if FAST_MAX
+	free += arena->fast_bytes;
+#endif
+	if (free > heap >> GROW_FREE_SHIFT) {
+		g->step = MAX(g->step / 2, g->min);
+	} else if (arena->op_clock - g->last < g->window) {
+		g->step = MIN(g->step * 2, cap);
+	}
+	g->last = arena->op_clock;
+	return MAX(need, g->step);
+}
+
+/*
+ * purge_stamp - Notes that the size bytes from lo just became free,
+ *         so every page they touch starts to decay again
+ */
+static inline void purge_stamp(char *lo, size_t size)
+{
+#if PURGE_DECAY
+	size_t i;
+
+	for (i = PURGE_INDEX(lo); i <= PURGE_INDEX(lo + size - 1); i++) {
+		arena->page_freed[i] = arena->op_clock;
+		arena->page_purged[i] = 0;
+	}
+#endif
+}
+
+#if PURGE_DECAY
+/*
+ * purge_link - Puts free block bp on the purge list if it has whole
+ *         pages inside, clear of its tags and links
+ */
+static void purge_link(void *bp)
+{
+	char *next = TO_PTR(arena->purge_head);
+
+	if (PURGE_INDEX((char *)bp + 4*WSIZE + PURGE_PAGE - 1) >= PURGE_INDEX(FTRP(bp))) {
+		return;
+	}
+	PUT(HDRP(bp), GET(HDRP(bp)) | PURGE_BIT);
+	PURGE_NEXT(bp) = arena->purge_head;
+	PURGE_PREV(bp) = 0;
+	if (next != NULL) {
+		PURGE_PREV(next) = TO_LINK(bp);
+	}
+	arena->purge_head = TO_LINK(bp);
+}
+
+/*
+ * purge_unlink - Takes free block bp off the purge list, zeroing its
+ *         links there for the zero_lo rule
+ */
+static void purge_unlink(void *bp)
+{
+	char *next = TO_PTR(PURGE_NEXT(bp));
+	char *prev = TO_PTR(PURGE_PREV(bp));
+
+	if (prev == NULL) {
+		arena->purge_head = PURGE_NEXT(bp);
+	} else {
+		PURGE_NEXT(prev) = PURGE_NEXT(bp);
+	}
+	if (next != NULL) {
+		PURGE_PREV(next) = PURGE_PREV(bp);
+	}
+	PURGE_NEXT(bp) = PURGE_PREV(bp) = 0;
+	PUT(HDRP(bp), GET(HDRP(bp)) & ~PURGE_BIT);
+}
+
+/*
+ * purge_sweep - Purges the pages inside free blocks on the purge
+ *         list, clear of their tags and links, that have been free
+ *         for PURGE_DECAY ops. Runs of such pages go to mem_purge()
+ *         together. Blocks with no page left to wait for leave the
+ *         list, as only a free that merges them can stamp it again.
+ */
+static void purge_sweep(void)
+{
+	char *bp, *next;
+	size_t i, end, hi;
+	int waiting;
+
+	arena->last_sweep = arena->op_clock;
+	for (bp = TO_PTR(arena->purge_head); bp != NULL; bp = next) {
+		next = TO_PTR(PURGE_NEXT(bp));
+		waiting = 0;
+		i = PURGE_INDEX(bp + 4*WSIZE + PURGE_PAGE - 1);
+		hi = PURGE_INDEX(FTRP(bp));
+		while (i < hi) {
+			for (; i < hi && (arena->page_purged[i] || arena->op_clock - arena->page_freed[i] < PURGE_DECAY); i++) {
+				waiting |= !arena->page_purged[i];
+			}
+			for (end = i; end < hi && !arena->page_purged[end] && arena->op_clock - arena->page_freed[end] >= PURGE_DECAY; end++) {
+				arena->page_purged[end] = 1;
+			}
+			if (end > i) {
+				mem_purge(arena->heap_lo + i*PURGE_PAGE, (end - i)*PURGE_PAGE);
+				arena->counters.purges++;
+				arena->counters.purged_bytes += (end - i)*PURGE_PAGE;
+			}
+			i = end;
+		}
+		if (!waiting) {
+			purge_unlink(bp);
+		}
+	}
+}
+
+/*
+ * check_purge - Checks the links of the purge list, returns how many
+ *         blocks are on it
+ */
+static int check_purge(void)
+{
+	int count = 0;
+	char *prev = NULL;
+
+	for (char *bp = TO_PTR(arena->purge_head); bp != NULL; bp = TO_PTR(PURGE_NEXT(bp))) {
+		if (!GET_FREE(HDRP(bp)) || !(GET(HDRP(bp)) & PURGE_BIT)) {
+			printf("%p is on the purge list but not a free block marked so!\n", bp);
+			return count;
+		}
+		if (TO_PTR(PURGE_PREV(bp)) != prev) {
+			printf("%p has purge list link back to %p, not %p!\n", bp, TO_PTR(PURGE_PREV(bp)), prev);
+		}
+		prev = bp;
+		count++;
+	}
+	return count;
+}
+#endif
 
 /* 
  * place - Place block of asize bytes at start of free block bp 
@@ -614,74 +3538,163 @@ static void place(void *bp, size_t asize)
 {
 	size_t csize = GET_SIZE(HDRP(bp));
 
+	remove_free(bp);
 	if ((csize - asize) >= MINSIZE) {
-		PUT(HDRP(bp), PACK(asize, 0));
-		PUT(FTRP(bp), PACK(asize, 0));
-		remove_from_list(bp);
+		PUT(HDRP(bp), PACK(asize, GET_PFREE(HDRP(bp))));
+		mark_dirty(bp);
 		bp = NEXT_BLKP(bp);
-		PUT(HDRP(bp), PACK(csize-asize, 1));
-		PUT(FTRP(bp), PACK(csize-asize, 1));
-		add_to_list(bp);
+		PUT(HDRP(bp), PACK(csize-asize, FREE_BIT));
+		PUT(FTRP(bp), PACK(csize-asize, FREE_BIT));
+		add_free(bp);
 	}
 	else { 
-		PUT(HDRP(bp), PACK(csize, 0));
-		PUT(FTRP(bp), PACK(csize, 0));
-		remove_from_list(bp);
+		PUT(HDRP(bp), PACK(csize, GET_PFREE(HDRP(bp))));
+		CLR_PFREE(HDRP(NEXT_BLKP(bp)));
+		mark_dirty(bp);
 	}
 }
 /* $end mmplace */
 
-/* 
- * find_fit - Find a fit for a block with asize bytes 
+/*
+ * place_split - Place block of asize bytes in free block bp, at the
+ *         back of it if small blocks are split from the back, and
+ *         return where it went. The wilderness is always split from
+ *         the front to keep it at the end of the heap.
  */
-static void *find_fit(size_t asize)
+static void *place_split(void *bp, size_t asize)
 {
-	// No more free blocks
-	if(free_listp == NULL){
-		return NULL;
+	size_t csize = GET_SIZE(HDRP(bp));
+	char *ap;
+
+	if (!split_back || asize > SPLIT_SMALL || csize - asize < MINSIZE || bp == arena->wild) {
+		place(bp, asize);
+		return bp;
 	}
 
-    /* Next fit search */
-	void *bp = free_listp;
-	void *bestP = bp;
-	void *first = NULL;
-	short flag = 0;
-	do {
-		if (GET_SIZE(HDRP(bp)) >= asize) {
-			if(GET_SIZE(HDRP(bestP)) > GET_SIZE(HDRP(bp))){
-				bestP = bp;
-				flag++;
-			}
-			if(!flag){
-				first = bp;
-				flag = 1;
-			}
-			if(flag == 2){
-				break;
-			}
-		}
-		bp = GET_PREV_FREE(bp);
-	} while(bp != free_listp);
-	if(asize <= GET_SIZE(HDRP(bestP))){
-		return bestP;
-	} else if(first != NULL){
-		return first;
+	// the front stays a free block, in a new list if its class changed
+	remove_free(bp);
+	PUT(HDRP(bp), PACK(csize-asize, FREE_BIT | GET_PFREE(HDRP(bp))));
+	PUT(FTRP(bp), PACK(csize-asize, FREE_BIT));
+	ap = NEXT_BLKP(bp);
+	PUT(HDRP(ap), PACK(asize, PFREE_BIT));
+	CLR_PFREE(HDRP(NEXT_BLKP(ap)));
+	add_free(bp);
+	mark_dirty(ap);
+	return ap;
+}
+
+/*
+ * place_batch - Place n blocks of asize bytes one after the other at
+ *         the start of free block bp, storing them in out. bp must
+ *         hold all n, the last one keeps any tail too small to split.
+ */
+static void place_batch(void *bp, size_t asize, size_t n, void **out)
+{
+	char *p = bp;
+	size_t csize, i;
+
+	place(bp, asize * n);
+	csize = GET_SIZE(HDRP(bp));
+	PUT(HDRP(p), PACK(asize, GET_PFREE(HDRP(p))));
+	for (i = 0; i < n - 1; i++) {
+		out[i] = p;
+		p += asize;
+		PUT(HDRP(p), PACK(asize, 0));
+	}
+	PUT(HDRP(p), PACK(csize - (n-1)*asize, GET_PFREE(HDRP(p))));
+	out[n-1] = p;
+}
+
+/*
+ * align_payload - Returns the first address in free block bp that is
+ *         aligned to align and leaves room for a free block before it
+ */
+static char *align_payload(void *bp, size_t align)
+{
+	char *ap = (char *)(((uintptr_t)bp + align - 1) / align * align);
+
+	// leading slack has to be big enough to be a free block
+	while (ap != (char *)bp && ap - (char *)bp < MINSIZE) {
+		ap += align;
+	}
+	return ap;
+}
+
+/*
+ * find_fit_aligned - Find a fit for a block with asize bytes whose
+ *         payload is aligned to align. The block find_fit() picks is
+ *         used if it has an aligned spot, else a block big enough to
+ *         hold one wherever it starts, else the wilderness if it has
+ *         an aligned spot.
+ */
+static void *find_fit_aligned(size_t asize, size_t align)
+{
+	char *bp = find_fit(asize);
+
+	if (bp != NULL && align_payload(bp, align) - bp + asize <= GET_SIZE(HDRP(bp))) {
+		return bp;
+	}
+	if ((bp = find_fit(asize + align + MINSIZE)) != NULL) {
+		return bp;
+	}
+	if (arena->wild != NULL && align_payload(arena->wild, align) - arena->wild + asize <= GET_SIZE(HDRP(arena->wild))) {
+		return arena->wild;
+	}
+	return NULL;
+}
+
+/*
+ * place_aligned - Place block of asize bytes in free block bp with
+ *         its payload aligned to align, a multiple of ALIGNSIZE. The
+ *         slack in front of it is split off as a free block, so bp
+ *         must have room for it, as found by find_fit_aligned().
+ */
+static void *place_aligned(void *bp, size_t asize, size_t align)
+{
+	char *ap = align_payload(bp, align);
+
+	if (ap != (char *)bp) {
+		size_t csize = GET_SIZE(HDRP(bp));
+		size_t lead = ap - (char *)bp;
+
+		remove_free(bp);
+		PUT(HDRP(bp), PACK(lead, FREE_BIT));
+		PUT(FTRP(bp), PACK(lead, FREE_BIT));
+		PUT(HDRP(ap), PACK(csize-lead, FREE_BIT | PFREE_BIT));
+		PUT(FTRP(ap), PACK(csize-lead, FREE_BIT));
+		add_free(bp);
+		add_free(ap);
+	}
+	place(ap, asize);
+	return ap;
+}
+
+/*
+ * malloc_aligned - Allocate a block of asize bytes whose payload is
+ *         aligned to align, extending the heap if no block has room
+ */
+static void *malloc_aligned(size_t asize, size_t align)
+{
+	size_t search = asize + align + MINSIZE;	/* always holds an aligned block */
+	char *bp;
+
+	if ((bp = find_fit_aligned(asize, align)) == NULL && (bp = wild_fit(search)) == NULL) {
+		return NULL;
 	}
-    return NULL; /* no fit */
+	return place_aligned(bp, asize, align);
 }
 
 static void printblock(void *bp)
 {
-	    size_t hsize, halloc;
+	    size_t hsize, hfree;
 
 		hsize = GET_SIZE(HDRP(bp));
-		halloc = GET_ALLOC(HDRP(bp));
+		hfree = GET_FREE(HDRP(bp));
 		
 		if (hsize == 0) {
 			printf("%p: EOL\n", bp);
 			return;
 		}
 
-		printf("%p: header: [%zu:%c]\n", bp, hsize, (halloc ? 'f' : 'a'));
+		printf("%p: header: [%zu:%c]\n", bp, hsize, (hfree ? 'f' : 'a'));
 }
-
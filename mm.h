@@ -2,11 +2,57 @@
 
 #define KEY2 ~(0xbeefdead)
 
+/* Returns 0 on success, -1 on error */
 extern int mm_init (void);
 extern void *mm_malloc (size_t size);
+extern void *mm_calloc (size_t nmemb, size_t size);
+extern void *mm_memalign (size_t align, size_t size);
+extern void *mm_aligned_alloc (size_t align, size_t size);
+extern size_t mm_malloc_batch (size_t size, size_t n, void **out);
 extern void mm_free (void *ptr);
+extern void mm_free_sized (void *ptr, size_t size);
+extern void mm_free_batch (void **ptrs, size_t n);
 extern void *mm_realloc(void *ptr, size_t size);
 extern void mm_checkheap(int verbose);
+extern int mm_probe_limit(int n);
+extern int mm_grow_policy(int id, size_t min, int max_shift, unsigned int window);
+extern int mm_fit_use(const char *name);
+extern const char *mm_fit_name(void);
+extern int mm_split_use(const char *name);
+extern const char *mm_split_name(void);
+
+/* Event counters kept by the mm package per arena, reset by mm_init() */
+typedef struct {
+    int reallocs;          /* mm_realloc() calls on a live block */
+    int realloc_inplace;   /* ... served without a new allocation */
+    int realloc_forward;   /* ... grown into the next free block */
+    int realloc_backward;  /* ... grown into the previous free block */
+    int realloc_extend;    /* ... grown by extending the heap */
+    int headroom_grants;   /* grown blocks given headroom past their size */
+    int headroom_hits;     /* later reallocs served within those blocks */
+    long headroom_bytes;   /* headroom handed out in all (bytes) */
+    int headroom_shift;    /* headroom is now 1/2^shift of a block */
+    long calloc_bytes;     /* bytes asked of mm_calloc() */
+    long calloc_zeroed;    /* ... that it had to clear */
+    int batch_runs;        /* mm_malloc_batch() runs cut from one free block */
+    long batch_merged;     /* blocks mm_free_batch() freed with the block before */
+    int mapped_blocks;     /* blocks given a mapping of their own */
+    int map_moves;         /* reallocs of them that mem_remap() moved */
+    int trims;             /* times the heap was shrunk */
+    long trimmed_bytes;    /* bytes it gave back in all */
+    int purges;            /* runs of free pages purged */
+    long purged_bytes;     /* bytes they held in all */
+    int sbrks;             /* times the heap was extended */
+    long sbrk_bytes;       /* bytes it was extended by in all */
+    int fast_mallocs;      /* mallocs of a size that has a fast bin */
+    int fast_hits;         /* ... served from it */
+    int fast_consolidations; /* times the fast bins were coalesced */
+    long fit_probes;       /* free blocks find_fit() looked at */
+    int fit_cutoffs;       /* searches stopped by the probe limit */
+} mm_counters_t;
+
+/* Stores the counters of all arenas in c, summed */
+extern void mm_get_counters(mm_counters_t *c);
 
 
 /* 
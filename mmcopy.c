@@ -0,0 +1,233 @@
+/*
+ * mmcopy.c - the copy used by mm_realloc() when a block has to move.
+ *
+ * The copy loop is picked on the first call from what the CPU
+ * supports: 32 byte AVX2 or 16 byte SSE2 moves on x86, word moves
+ * anywhere else. Copies of MM_COPY_NT bytes or more are written
+ * with non-temporal stores, so moving a huge block does not evict
+ * the rest of the heap from the cache on its way through.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "mmcopy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86	1
+#else
+#define HAVE_X86	0
+#endif
+
+/* A copy loop, n bytes from src to dest */
+typedef void (*copy_fn)(char *dest, const char *src, size_t n);
+
+/* Word that may alias anything, for the word wide loop */
+typedef size_t __attribute__((may_alias)) word_t;
+
+static copy_fn copy_loop;		/* loop in use, NULL until selected */
+static const char *copy_loop_name;
+
+/*
+ * copy_small - Copies n < 16 bytes with at most two overlapping
+ *         moves of the largest width that fits
+ */
+static inline void copy_small(char *dest, const char *src, size_t n)
+{
+	if (n >= 8) {
+		uint64_t a, b;
+		memcpy(&a, src, 8);
+		memcpy(&b, src + n - 8, 8);
+		memcpy(dest, &a, 8);
+		memcpy(dest + n - 8, &b, 8);
+	} else if (n >= 4) {
+		uint32_t a, b;
+		memcpy(&a, src, 4);
+		memcpy(&b, src + n - 4, 4);
+		memcpy(dest, &a, 4);
+		memcpy(dest + n - 4, &b, 4);
+	} else {
+		while (n-- > 0) {
+			*dest++ = *src++;
+		}
+	}
+}
+
+/*
+ * copy_words - Portable loop, four words per iteration
+ */
+static void copy_words(char *dest, const char *src, size_t n)
+{
+	const size_t w = sizeof(word_t);
+
+	for (; n >= 4 * w; n -= 4 * w, dest += 4 * w, src += 4 * w) {
+		word_t a = ((const word_t *)src)[0];
+		word_t b = ((const word_t *)src)[1];
+		word_t c = ((const word_t *)src)[2];
+		word_t d = ((const word_t *)src)[3];
+		((word_t *)dest)[0] = a;
+		((word_t *)dest)[1] = b;
+		((word_t *)dest)[2] = c;
+		((word_t *)dest)[3] = d;
+	}
+	for (; n >= w; n -= w, dest += w, src += w) {
+		*(word_t *)dest = *(const word_t *)src;
+	}
+	copy_small(dest, src, n);
+}
+
+#if HAVE_X86
+/*
+ * copy_sse2 - 64 bytes per iteration in 16 byte moves, streaming
+ *         to dest once it is aligned if n is MM_COPY_NT or more
+ */
+__attribute__((target("sse2")))
+static void copy_sse2(char *dest, const char *src, size_t n)
+{
+	__m128i tail;
+
+	if (n < 16) {
+		copy_small(dest, src, n);
+		return;
+	}
+	tail = _mm_loadu_si128((const __m128i *)(src + n - 16));
+	char *end = dest + n - 16;
+
+	if (n >= MM_COPY_NT) {
+		size_t head = (16 - ((uintptr_t)dest & 15)) & 15;
+		_mm_storeu_si128((__m128i *)dest, _mm_loadu_si128((const __m128i *)src));
+		dest += head; src += head; n -= head;
+		for (; n >= 64; n -= 64, dest += 64, src += 64) {
+			__m128i a = _mm_loadu_si128((const __m128i *)src);
+			__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+			__m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+			__m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+			_mm_stream_si128((__m128i *)dest, a);
+			_mm_stream_si128((__m128i *)(dest + 16), b);
+			_mm_stream_si128((__m128i *)(dest + 32), c);
+			_mm_stream_si128((__m128i *)(dest + 48), d);
+		}
+		_mm_sfence();
+	}
+	for (; n >= 64; n -= 64, dest += 64, src += 64) {
+		__m128i a = _mm_loadu_si128((const __m128i *)src);
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+		__m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+		_mm_storeu_si128((__m128i *)dest, a);
+		_mm_storeu_si128((__m128i *)(dest + 16), b);
+		_mm_storeu_si128((__m128i *)(dest + 32), c);
+		_mm_storeu_si128((__m128i *)(dest + 48), d);
+	}
+	for (; n > 16; n -= 16, dest += 16, src += 16) {
+		_mm_storeu_si128((__m128i *)dest, _mm_loadu_si128((const __m128i *)src));
+	}
+	// last 16 bytes, overlapping what was already copied
+	_mm_storeu_si128((__m128i *)end, tail);
+}
+
+/*
+ * copy_avx2 - 128 bytes per iteration in 32 byte moves, streaming
+ *         to dest once it is aligned if n is MM_COPY_NT or more
+ */
+__attribute__((target("avx2")))
+static void copy_avx2(char *dest, const char *src, size_t n)
+{
+	__m256i tail;
+
+	if (n < 32) {
+		if (n >= 16) {
+			__m128i a = _mm_loadu_si128((const __m128i *)src);
+			__m128i b = _mm_loadu_si128((const __m128i *)(src + n - 16));
+			_mm_storeu_si128((__m128i *)dest, a);
+			_mm_storeu_si128((__m128i *)(dest + n - 16), b);
+		} else {
+			copy_small(dest, src, n);
+		}
+		return;
+	}
+	tail = _mm256_loadu_si256((const __m256i *)(src + n - 32));
+	char *end = dest + n - 32;
+
+	if (n >= MM_COPY_NT) {
+		size_t head = (32 - ((uintptr_t)dest & 31)) & 31;
+		_mm256_storeu_si256((__m256i *)dest, _mm256_loadu_si256((const __m256i *)src));
+		dest += head; src += head; n -= head;
+		for (; n >= 128; n -= 128, dest += 128, src += 128) {
+			__m256i a = _mm256_loadu_si256((const __m256i *)src);
+			__m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+			__m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+			__m256i d = _mm256_loadu_si256((const __m256i *)(src + 96));
+			_mm256_stream_si256((__m256i *)dest, a);
+			_mm256_stream_si256((__m256i *)(dest + 32), b);
+			_mm256_stream_si256((__m256i *)(dest + 64), c);
+			_mm256_stream_si256((__m256i *)(dest + 96), d);
+		}
+		_mm_sfence();
+	}
+	for (; n >= 128; n -= 128, dest += 128, src += 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)src);
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(src + 96));
+		_mm256_storeu_si256((__m256i *)dest, a);
+		_mm256_storeu_si256((__m256i *)(dest + 32), b);
+		_mm256_storeu_si256((__m256i *)(dest + 64), c);
+		_mm256_storeu_si256((__m256i *)(dest + 96), d);
+	}
+	for (; n > 32; n -= 32, dest += 32, src += 32) {
+		_mm256_storeu_si256((__m256i *)dest, _mm256_loadu_si256((const __m256i *)src));
+	}
+	// last 32 bytes, overlapping what was already copied
+	_mm256_storeu_si256((__m256i *)end, tail);
+}
+#endif
+
+/*
+ * mm_memcpy_use - Selects the copy loop by name, or the best one
+ *         the CPU supports if name is NULL
+ */
+int mm_memcpy_use(const char *name)
+{
+#if HAVE_X86
+	__builtin_cpu_init();
+	if ((name == NULL || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+		copy_loop = copy_avx2;
+		copy_loop_name = "avx2";
+		return 0;
+	}
+	if ((name == NULL || strcmp(name, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+		copy_loop = copy_sse2;
+		copy_loop_name = "sse2";
+		return 0;
+	}
+#endif
+	if (name == NULL || strcmp(name, "words") == 0) {
+		copy_loop = copy_words;
+		copy_loop_name = "words";
+		return 0;
+	}
+	return -1;
+}
+
+/*
+ * mm_memcpy_name - Returns the name of the copy loop in use
+ */
+const char *mm_memcpy_name(void)
+{
+	if (copy_loop == NULL) {
+		mm_memcpy_use(NULL);
+	}
+	return copy_loop_name;
+}
+
+/*
+ * mm_memcpy - Copies n bytes from src to dest with the selected loop
+ */
+void mm_memcpy(void *dest, const void *src, size_t n)
+{
+	if (copy_loop == NULL) {
+		mm_memcpy_use(NULL);
+	}
+	copy_loop(dest, src, n);
+}
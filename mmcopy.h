@@ -0,0 +1,16 @@
+#include <stddef.h>
+
+/* Copies of at least this many bytes use non-temporal stores */
+#ifndef MM_COPY_NT
+#define MM_COPY_NT (2*(1<<20))
+#endif
+
+/* Copy n bytes from src to dest, the two must not overlap */
+void mm_memcpy(void *dest, const void *src, size_t n);
+
+/* Force the named copy loop ("avx2", "sse2" or "words"), or NULL
+   for the best one the CPU supports. Returns -1 if unsupported */
+int mm_memcpy_use(const char *name);
+
+/* Name of the copy loop in use */
+const char *mm_memcpy_name(void);
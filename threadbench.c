@@ -0,0 +1,183 @@
+/*
+ * threadbench.c - Measures how mm_malloc() and mm_free() scale with
+ *                 the number of threads, against libc malloc
+ *
+ * For 1, 2, 4, ... up to 64 threads, every thread replaces random
+ * blocks of a working set of its own with new ones of random small
+ * sizes, first with the mm package and then with libc. The total
+ * throughput is printed in Mops/s, one malloc or free being one op,
+ * with the speedup over one thread. With -r the threads pass their
+ * working sets on to the next thread half way through, so half the
+ * frees are of blocks another thread allocated.
+ *
+ * usage: threadbench [-r] [-n ops] [-t threads]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define MAX_THREADS	64		/* most threads run */
+#define SLOTS		1024	/* blocks in a working set */
+#define MAX_SIZE	512		/* largest block (bytes) */
+
+/* An allocator to measure */
+typedef struct {
+	const char *name;
+	void *(*malloc)(size_t size);
+	void (*free)(void *ptr);
+} alloc_t;
+
+static const alloc_t allocs[] = {
+	{ "mm", mm_malloc, mm_free },
+	{ "libc", malloc, free },
+};
+#define NUM_ALLOCS	(sizeof(allocs) / sizeof(allocs[0]))
+
+static long ops = 1000000;	/* block replacements per thread */
+static int remote;			/* set if working sets change threads */
+static int nthreads;		/* threads in the current run */
+static const alloc_t *alloc;	/* allocator of the current run */
+static void **sets[MAX_THREADS];	/* working set of each thread */
+static pthread_barrier_t halfway;
+
+/*
+ * worker - Replaces ops random blocks of the working set of thread
+ *     argp, switching to the next thread's set half way with -r, and
+ *     frees the set it ends with
+ */
+static void *worker(void *argp)
+{
+	long id = (long)argp;
+	void **set = sets[id];
+	unsigned int x = 2654435761u * (id + 1);	/* xorshift state */
+
+	for (long i = 0; i < ops; i++) {
+		if (remote && i == ops / 2) {
+			pthread_barrier_wait(&halfway);
+			set = sets[(id + 1) % nthreads];
+		}
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		int k = x % SLOTS;
+		if (set[k] != NULL) {
+			alloc->free(set[k]);
+		}
+		if ((set[k] = alloc->malloc((x >> 16) % MAX_SIZE + 1)) == NULL) {
+			fprintf(stderr, "threadbench: %s out of memory\n", alloc->name);
+			exit(1);
+		}
+		*(char *)set[k] = (char)i;
+	}
+	for (int k = 0; k < SLOTS; k++) {
+		if (set[k] != NULL) {
+			alloc->free(set[k]);
+			set[k] = NULL;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * run - Returns the throughput of allocator a with n threads in Mops/s
+ */
+static double run(const alloc_t *a, int n)
+{
+	pthread_t tids[MAX_THREADS];
+	struct timespec start, end;
+	long i;
+
+	alloc = a;
+	nthreads = n;
+	if (a->malloc == mm_malloc) {
+		mem_reset_brk();
+		if (mm_init() < 0) {
+			fprintf(stderr, "threadbench: mm_init failed\n");
+			exit(1);
+		}
+	}
+	pthread_barrier_init(&halfway, NULL, n);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++) {
+		if (pthread_create(&tids[i], NULL, worker, (void *)i) != 0) {
+			fprintf(stderr, "threadbench: pthread_create failed\n");
+			exit(1);
+		}
+	}
+	for (i = 0; i < n; i++) {
+		pthread_join(tids[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	pthread_barrier_destroy(&halfway);
+	double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	return 2.0 * ops * n / secs / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	double base[NUM_ALLOCS];
+	int maxthreads = MAX_THREADS;
+	int c, n;
+	size_t i;
+
+	while ((c = getopt(argc, argv, "rn:t:")) != EOF) {
+		switch (c) {
+		case 'r':
+			remote = 1;
+			break;
+		case 'n':
+			ops = atol(optarg);
+			break;
+		case 't':
+			maxthreads = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: threadbench [-r] [-n ops] [-t threads]\n");
+			exit(1);
+		}
+	}
+	if (ops < 2 || maxthreads < 1 || maxthreads > MAX_THREADS) {
+		fprintf(stderr, "threadbench: need at least 2 ops and 1 to %d threads\n", MAX_THREADS);
+		exit(1);
+	}
+
+	for (n = 0; n < maxthreads; n++) {
+		if ((sets[n] = calloc(SLOTS, sizeof(void *))) == NULL) {
+			fprintf(stderr, "threadbench: out of memory\n");
+			exit(1);
+		}
+	}
+	mem_init();
+
+	printf("Mops/s, %ld blocks of 1 to %d bytes replaced per thread, %s frees\n",
+		   ops, MAX_SIZE, remote ? "half remote" : "local");
+	printf("%8s", "threads");
+	for (i = 0; i < NUM_ALLOCS; i++) {
+		printf("%8s%8s", allocs[i].name, "speedup");
+	}
+	printf("\n");
+
+	for (n = 1; n <= maxthreads; n *= 2) {
+		printf("%8d", n);
+		for (i = 0; i < NUM_ALLOCS; i++) {
+			double mops = run(&allocs[i], n);
+			if (n == 1) {
+				base[i] = mops;
+			}
+			printf("%8.1f%8.2f", mops, mops / base[i]);
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	mem_deinit();
+	return 0;
+}